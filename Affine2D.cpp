@@ -0,0 +1,232 @@
+#include "Affine2D.h"
+
+#include <cmath>
+#include <glm/simd/common.h>
+
+
+namespace {
+
+constexpr float DEGREES_TO_RADIANS = 0.017453292519943295f;
+
+// The 2D part of the parent transformation.
+struct Parent {
+    float m00, m10, m01, m11, tx, ty;
+    glm::vec4 z_column;
+    float tz, tw;
+
+    explicit Parent(const glm::mat4& parent)
+        : m00(parent[0][0]), m10(parent[0][1]), m01(parent[1][0]), m11(parent[1][1]),
+          tx(parent[3][0]), ty(parent[3][1]), z_column(parent[2]), tz(parent[3][2]), tw(parent[3][3]) {}
+};
+
+inline void store(const Parent& p, float a, float b, float e, float f, float tx, float ty, glm::mat4& out) {
+    out[0] = glm::vec4(a, b, 0.0f, 0.0f);
+    out[1] = glm::vec4(e, f, 0.0f, 0.0f);
+    out[2] = p.z_column;
+    out[3] = glm::vec4(tx, ty, p.tz, p.tw);
+}
+
+inline void store(const Parent&, float a, float b, float e, float f, float tx, float ty, Affine2D& out) {
+    out.m[0][0] = a;
+    out.m[0][1] = b;
+    out.m[1][0] = e;
+    out.m[1][1] = f;
+    out.m[2][0] = tx;
+    out.m[2][1] = ty;
+}
+
+template <typename Out>
+inline void composeScalar(const Parent& p, float x, float y, float angle, float scale, Out& out) {
+    const float radians = angle * DEGREES_TO_RADIANS;
+    const float c = std::cos(radians) * scale, s = std::sin(radians) * scale;
+    store(p,
+        p.m00 * c + p.m01 * s, p.m10 * c + p.m11 * s,
+        p.m01 * c - p.m00 * s, p.m11 * c - p.m10 * s,
+        p.m00 * x + p.m01 * y + p.tx, p.m10 * x + p.m11 * y + p.ty,
+        out);
+}
+
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+
+// Cody-Waite split of pi/2 and minimax polynomials on [-pi/4, pi/4] (Cephes sinf/cosf).
+constexpr float TWO_OVER_PI = 0.63661977236758134f;
+constexpr float PI_OVER_2_HI = 1.5703125f;
+constexpr float PI_OVER_2_MID = 4.837512969970703125e-4f;
+constexpr float PI_OVER_2_LO = 7.549789948768648e-8f;
+constexpr float SIN_C1 = -1.6666654611e-1f, SIN_C2 = 8.3321608736e-3f, SIN_C3 = -1.9515295891e-4f;
+constexpr float COS_C1 = 4.166664568298827e-2f, COS_C2 = -1.388731625493765e-3f, COS_C3 = 2.443315711809948e-5f;
+
+inline void sincos4(glm_vec4 x, glm_vec4& sin_out, glm_vec4& cos_out) {
+    // x = r + q * pi/2 with |r| <= pi/4
+    const glm_ivec4 q = _mm_cvtps_epi32(glm_vec4_mul(x, _mm_set1_ps(TWO_OVER_PI)));
+    const glm_vec4 qf = _mm_cvtepi32_ps(q);
+    glm_vec4 r = glm_vec4_sub(x, glm_vec4_mul(qf, _mm_set1_ps(PI_OVER_2_HI)));
+    r = glm_vec4_sub(r, glm_vec4_mul(qf, _mm_set1_ps(PI_OVER_2_MID)));
+    r = glm_vec4_sub(r, glm_vec4_mul(qf, _mm_set1_ps(PI_OVER_2_LO)));
+
+    const glm_vec4 z = glm_vec4_mul(r, r);
+    glm_vec4 sin_r = glm_vec4_fma(z, _mm_set1_ps(SIN_C3), _mm_set1_ps(SIN_C2));
+    sin_r = glm_vec4_fma(sin_r, z, _mm_set1_ps(SIN_C1));
+    sin_r = glm_vec4_fma(glm_vec4_mul(sin_r, z), r, r);
+    glm_vec4 cos_r = glm_vec4_fma(z, _mm_set1_ps(COS_C3), _mm_set1_ps(COS_C2));
+    cos_r = glm_vec4_fma(cos_r, z, _mm_set1_ps(COS_C1));
+    cos_r = glm_vec4_fma(glm_vec4_mul(cos_r, z), z, _mm_sub_ps(_mm_set1_ps(1.0f), glm_vec4_mul(z, _mm_set1_ps(0.5f))));
+
+    // Odd quadrants swap sine and cosine, the sign comes from bit 1 of q (and of q + 1 for the cosine)
+    const glm_ivec4 one = _mm_set1_epi32(1), two = _mm_set1_epi32(2);
+    const glm_vec4 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, one), one));
+    const glm_vec4 sin_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, two), 30));
+    const glm_vec4 cos_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(q, one), two), 30));
+    sin_out = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, cos_r), _mm_andnot_ps(swap, sin_r)), sin_sign);
+    cos_out = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, sin_r), _mm_andnot_ps(swap, cos_r)), cos_sign);
+}
+
+inline void store4(const Parent& p, glm_vec4 a, glm_vec4 b, glm_vec4 e, glm_vec4 f, glm_vec4 tx, glm_vec4 ty,
+    glm::mat4* out) {
+    // Interleave the lanes into (a b 0 0), (e f 0 0) and (tx ty tz tw) columns
+    const glm_vec4 zero = _mm_setzero_ps();
+    const glm_vec4 zw = _mm_setr_ps(p.tz, p.tw, p.tz, p.tw);
+    const glm_vec4 z_column = _mm_loadu_ps(&p.z_column[0]);
+    const glm_vec4 ab[2] = {_mm_unpacklo_ps(a, b), _mm_unpackhi_ps(a, b)};
+    const glm_vec4 ef[2] = {_mm_unpacklo_ps(e, f), _mm_unpackhi_ps(e, f)};
+    const glm_vec4 t[2] = {_mm_unpacklo_ps(tx, ty), _mm_unpackhi_ps(tx, ty)};
+    for (int half = 0; half < 2; half++) {
+        float* m = &out[2 * half][0][0];
+        _mm_storeu_ps(m, _mm_movelh_ps(ab[half], zero));
+        _mm_storeu_ps(m + 4, _mm_movelh_ps(ef[half], zero));
+        _mm_storeu_ps(m + 8, z_column);
+        _mm_storeu_ps(m + 12, _mm_movelh_ps(t[half], zw));
+        _mm_storeu_ps(m + 16, _mm_movehl_ps(zero, ab[half]));
+        _mm_storeu_ps(m + 20, _mm_movehl_ps(zero, ef[half]));
+        _mm_storeu_ps(m + 24, z_column);
+        _mm_storeu_ps(m + 28, _mm_movehl_ps(zw, t[half]));
+    }
+}
+
+inline void store4(const Parent&, glm_vec4 a, glm_vec4 b, glm_vec4 e, glm_vec4 f, glm_vec4 tx, glm_vec4 ty,
+    Affine2D* out) {
+    // Interleave into (a b e f tx ty) per transformation
+    const glm_vec4 ab_lo = _mm_unpacklo_ps(a, b), ab_hi = _mm_unpackhi_ps(a, b);
+    const glm_vec4 ef_lo = _mm_unpacklo_ps(e, f), ef_hi = _mm_unpackhi_ps(e, f);
+    const glm_vec4 t_lo = _mm_unpacklo_ps(tx, ty), t_hi = _mm_unpackhi_ps(tx, ty);
+    float* m = &out[0].m[0][0];
+    _mm_storel_pi(reinterpret_cast<__m64*>(m + 0), ab_lo);
+    _mm_storel_pi(reinterpret_cast<__m64*>(m + 2), ef_lo);
+    _mm_storel_pi(reinterpret_cast<__m64*>(m + 4), t_lo);
+    _mm_storeh_pi(reinterpret_cast<__m64*>(m + 6), ab_lo);
+    _mm_storeh_pi(reinterpret_cast<__m64*>(m + 8), ef_lo);
+    _mm_storeh_pi(reinterpret_cast<__m64*>(m + 10), t_lo);
+    _mm_storel_pi(reinterpret_cast<__m64*>(m + 12), ab_hi);
+    _mm_storel_pi(reinterpret_cast<__m64*>(m + 14), ef_hi);
+    _mm_storel_pi(reinterpret_cast<__m64*>(m + 16), t_hi);
+    _mm_storeh_pi(reinterpret_cast<__m64*>(m + 18), ab_hi);
+    _mm_storeh_pi(reinterpret_cast<__m64*>(m + 20), ef_hi);
+    _mm_storeh_pi(reinterpret_cast<__m64*>(m + 22), t_hi);
+}
+
+template <typename Out>
+inline void compose4(const Parent& p, const float* x, const float* y, const float* angles, const float* scales,
+    Out* out) {
+    glm_vec4 s, c;
+    sincos4(glm_vec4_mul(_mm_loadu_ps(angles), _mm_set1_ps(DEGREES_TO_RADIANS)), s, c);
+    const glm_vec4 scale = _mm_loadu_ps(scales);
+    c = glm_vec4_mul(c, scale);
+    s = glm_vec4_mul(s, scale);
+    const glm_vec4 m00 = _mm_set1_ps(p.m00), m10 = _mm_set1_ps(p.m10);
+    const glm_vec4 m01 = _mm_set1_ps(p.m01), m11 = _mm_set1_ps(p.m11);
+    const glm_vec4 px = _mm_loadu_ps(x), py = _mm_loadu_ps(y);
+    store4(p,
+        glm_vec4_fma(m00, c, glm_vec4_mul(m01, s)), glm_vec4_fma(m10, c, glm_vec4_mul(m11, s)),
+        glm_vec4_sub(glm_vec4_mul(m01, c), glm_vec4_mul(m00, s)), glm_vec4_sub(glm_vec4_mul(m11, c), glm_vec4_mul(m10, s)),
+        glm_vec4_fma(m00, px, glm_vec4_fma(m01, py, _mm_set1_ps(p.tx))),
+        glm_vec4_fma(m10, px, glm_vec4_fma(m11, py, _mm_set1_ps(p.ty))),
+        out);
+}
+
+#endif
+
+#if GLM_ARCH & GLM_ARCH_AVX2_BIT
+
+inline void sincos8(__m256 x, __m256& sin_out, __m256& cos_out) {
+    const __m256i q = _mm256_cvtps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(TWO_OVER_PI)));
+    const __m256 qf = _mm256_cvtepi32_ps(q);
+    __m256 r = _mm256_sub_ps(x, _mm256_mul_ps(qf, _mm256_set1_ps(PI_OVER_2_HI)));
+    r = _mm256_sub_ps(r, _mm256_mul_ps(qf, _mm256_set1_ps(PI_OVER_2_MID)));
+    r = _mm256_sub_ps(r, _mm256_mul_ps(qf, _mm256_set1_ps(PI_OVER_2_LO)));
+
+    const __m256 z = _mm256_mul_ps(r, r);
+    __m256 sin_r = _mm256_add_ps(_mm256_mul_ps(z, _mm256_set1_ps(SIN_C3)), _mm256_set1_ps(SIN_C2));
+    sin_r = _mm256_add_ps(_mm256_mul_ps(sin_r, z), _mm256_set1_ps(SIN_C1));
+    sin_r = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(sin_r, z), r), r);
+    __m256 cos_r = _mm256_add_ps(_mm256_mul_ps(z, _mm256_set1_ps(COS_C3)), _mm256_set1_ps(COS_C2));
+    cos_r = _mm256_add_ps(_mm256_mul_ps(cos_r, z), _mm256_set1_ps(COS_C1));
+    cos_r = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(cos_r, z), z),
+        _mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(z, _mm256_set1_ps(0.5f))));
+
+    const __m256i one = _mm256_set1_epi32(1), two = _mm256_set1_epi32(2);
+    const __m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(q, one), one));
+    const __m256 sin_sign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(q, two), 30));
+    const __m256 cos_sign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(q, one), two), 30));
+    sin_out = _mm256_xor_ps(_mm256_blendv_ps(sin_r, cos_r, swap), sin_sign);
+    cos_out = _mm256_xor_ps(_mm256_blendv_ps(cos_r, sin_r, swap), cos_sign);
+}
+
+template <typename Out>
+inline void compose8(const Parent& p, const float* x, const float* y, const float* angles, const float* scales,
+    Out* out) {
+    __m256 s, c;
+    sincos8(_mm256_mul_ps(_mm256_loadu_ps(angles), _mm256_set1_ps(DEGREES_TO_RADIANS)), s, c);
+    const __m256 scale = _mm256_loadu_ps(scales);
+    c = _mm256_mul_ps(c, scale);
+    s = _mm256_mul_ps(s, scale);
+    const __m256 m00 = _mm256_set1_ps(p.m00), m10 = _mm256_set1_ps(p.m10);
+    const __m256 m01 = _mm256_set1_ps(p.m01), m11 = _mm256_set1_ps(p.m11);
+    const __m256 px = _mm256_loadu_ps(x), py = _mm256_loadu_ps(y);
+    const __m256 lanes[6] = {
+        _mm256_add_ps(_mm256_mul_ps(m00, c), _mm256_mul_ps(m01, s)),
+        _mm256_add_ps(_mm256_mul_ps(m10, c), _mm256_mul_ps(m11, s)),
+        _mm256_sub_ps(_mm256_mul_ps(m01, c), _mm256_mul_ps(m00, s)),
+        _mm256_sub_ps(_mm256_mul_ps(m11, c), _mm256_mul_ps(m10, s)),
+        _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m00, px), _mm256_mul_ps(m01, py)), _mm256_set1_ps(p.tx)),
+        _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m10, px), _mm256_mul_ps(m11, py)), _mm256_set1_ps(p.ty))
+    };
+    // The stores work on 128-bit halves
+    store4(p, _mm256_castps256_ps128(lanes[0]), _mm256_castps256_ps128(lanes[1]), _mm256_castps256_ps128(lanes[2]),
+        _mm256_castps256_ps128(lanes[3]), _mm256_castps256_ps128(lanes[4]), _mm256_castps256_ps128(lanes[5]), out);
+    store4(p, _mm256_extractf128_ps(lanes[0], 1), _mm256_extractf128_ps(lanes[1], 1), _mm256_extractf128_ps(lanes[2], 1),
+        _mm256_extractf128_ps(lanes[3], 1), _mm256_extractf128_ps(lanes[4], 1), _mm256_extractf128_ps(lanes[5], 1), out + 4);
+}
+
+#endif
+
+template <typename Out>
+void composeBatch(const glm::mat4& parent, const float* x, const float* y, const float* angles,
+    const float* scales, std::size_t count, Out* out) {
+    const Parent p(parent);
+    std::size_t i = 0;
+#if GLM_ARCH & GLM_ARCH_AVX2_BIT
+    for (; i + 8 <= count; i += 8) {
+        compose8(p, x + i, y + i, angles + i, scales + i, out + i);
+    }
+#endif
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+    for (; i + 4 <= count; i += 4) {
+        compose4(p, x + i, y + i, angles + i, scales + i, out + i);
+    }
+#endif
+    for (; i < count; i++) {
+        composeScalar(p, x[i], y[i], angles[i], scales[i], out[i]);
+    }
+}
+
+} // namespace
+
+void composeAffine2D(const glm::mat4& parent, const float* x, const float* y, const float* angles,
+    const float* scales, std::size_t count, glm::mat4* out) {
+    composeBatch(parent, x, y, angles, scales, count, out);
+}
+
+void composeAffine2D(const glm::mat4& parent, const float* x, const float* y, const float* angles,
+    const float* scales, std::size_t count, Affine2D* out) {
+    composeBatch(parent, x, y, angles, scales, count, out);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "../mgl/mgl.hpp"
+#include <cstddef>
+
+// Packed 2D affine transformation, column-major like a GLSL mat3x2:
+// the two basis vectors followed by the translation.
+struct Affine2D {
+	float m[3][2];
+};
+
+/* Batched composition of 2D rigid transformations given as arrays of
+   positions, angles (degrees around the z axis) and uniform scales:
+
+		out[i] = parent * translate(x[i], y[i]) * rotate(angle[i]) * scale(scale[i])
+
+   The parent must be a 2D affine transformation (rotation around z, scale and
+   translation in the xy plane). Lanes are processed 8 or 4 at a time with
+   AVX2 or SSE2 when glm is built with intrinsics, with a scalar tail.
+   Arrays do not need to be aligned.
+*/
+void composeAffine2D(const glm::mat4& parent, const float* x, const float* y, const float* angles,
+	const float* scales, std::size_t count, glm::mat4* out);
+
+void composeAffine2D(const glm::mat4& parent, const float* x, const float* y, const float* angles,
+	const float* scales, std::size_t count, Affine2D* out);
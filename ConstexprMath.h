@@ -0,0 +1,100 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+// Compile-time replacements for the bits of cmath and glm used by the tangram
+// layout. glm types are not literal types once SIMD is enabled, so matrices are
+// kept as plain column-major arrays and converted with toGlm() at runtime.
+namespace cx {
+
+constexpr double PI = 3.14159265358979323846;
+
+constexpr double abs(double x) { return x < 0 ? -x : x; }
+
+constexpr double sqrt(double x) {
+    if (x <= 0.0) {
+        return 0.0;
+    }
+    // Newton's method converges monotonically from any guess above the root.
+    double root = x > 1.0 ? x : 1.0;
+    for (int i = 0; i < 128; i++) {
+        const double next = 0.5 * (root + x / root);
+        if (next >= root) {
+            break;
+        }
+        root = next;
+    }
+    return root;
+}
+
+constexpr double radians(double degrees) { return degrees * PI / 180.0; }
+
+// Taylor series after reducing the angle to [-pi, pi].
+constexpr double sin(double x) {
+    const double turns = x / (2 * PI);
+    const long long whole = static_cast<long long>(turns < 0 ? turns - 0.5 : turns + 0.5);
+    x -= static_cast<double>(whole) * 2 * PI;
+    double term = x, sum = x;
+    for (int n = 1; n < 16; n++) {
+        term *= -x * x / ((2 * n) * (2 * n + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double cos(double x) { return sin(x + PI / 2); }
+
+constexpr bool nearlyEqual(double a, double b, double epsilon = 1e-4) { return abs(a - b) <= epsilon; }
+
+// Column-major like glm: m[column][row].
+struct Mat4 {
+    float m[4][4];
+};
+
+constexpr Mat4 identity() {
+    return {{{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}}};
+}
+
+constexpr Mat4 operator*(const Mat4& a, const Mat4& b) {
+    Mat4 r = {};
+    for (int column = 0; column < 4; column++) {
+        for (int row = 0; row < 4; row++) {
+            double sum = 0.0;
+            for (int k = 0; k < 4; k++) {
+                sum += static_cast<double>(a.m[k][row]) * b.m[column][k];
+            }
+            r.m[column][row] = static_cast<float>(sum);
+        }
+    }
+    return r;
+}
+
+constexpr Mat4 translate(double x, double y) {
+    Mat4 r = identity();
+    r.m[3][0] = static_cast<float>(x);
+    r.m[3][1] = static_cast<float>(y);
+    return r;
+}
+
+// Rotation around the z axis, in degrees.
+constexpr Mat4 rotate(double degrees) {
+    const double c = cos(radians(degrees)), s = sin(radians(degrees));
+    Mat4 r = identity();
+    r.m[0][0] = static_cast<float>(c);
+    r.m[0][1] = static_cast<float>(s);
+    r.m[1][0] = static_cast<float>(-s);
+    r.m[1][1] = static_cast<float>(c);
+    return r;
+}
+
+constexpr Mat4 scale(double x, double y) {
+    Mat4 r = identity();
+    r.m[0][0] = static_cast<float>(x);
+    r.m[1][1] = static_cast<float>(y);
+    return r;
+}
+
+inline glm::mat4 toGlm(const Mat4& m) { return glm::make_mat4(&m.m[0][0]); }
+
+} // namespace cx
@@ -0,0 +1,191 @@
+#pragma once
+
+#include "ConstexprMath.h"
+#include "Shape2D.h"
+#include <array>
+
+// Global transformation the dragon is shown with. The scale is applied to the
+// whole figure, the rotation tilts the tangram slightly to the left.
+constexpr float DEFAULT_GLOBAL_SCALE = 0.5f; // Scales above 0.5f may cause pieces to go out of view
+constexpr float DEFAULT_GLOBAL_ROTATION = 10.0f;
+
+// A piece of a figure, in figure space at unit scale.
+struct PieceLayout {
+    int mesh;
+    float x, y;
+    float rotation; // Degrees around the z axis
+    float scale;
+    float color[4];
+};
+
+/* Tangram piece sizes:
+	-The square side length is half the biggest triangle side length.
+	-The parallelogram side length is also half the biggest triangle side length.
+	-The small triangles side length is half the biggest triangle side length.
+	-The medium triangle side length is the same as the biggest triangle side length divided by sqrt(2).
+   This sizes are fixed and should not be changed to maintain the Tangram proportions.
+*/
+constexpr float SQUARE_RATIO = 0.5f;
+constexpr float MEDIUM_TRIANGLE_RATIO = static_cast<float>(1 / cx::sqrt(2));
+constexpr float SMALL_TRIANGLE_RATIO = 0.5f;
+constexpr float PARALLELOGRAM_RATIO = 0.5f;
+
+constexpr std::array<PieceLayout, 7> makeDragonLayout() {
+    // Square calculations
+    // Variables
+    const double square_side = SQUARE_RATIO * shapeSideLength(SQUARE);
+
+    const double square_diagonal = cx::sqrt(2 * square_side * square_side);
+
+    // Positioning
+    // Center of the Tangram is the square center. Moving the square moves the entire Tangram.
+    const double square_x_offset = 0.0;
+
+    const double square_y_offset = 0.0;
+
+
+    // First triangle calculations (Magenta triangle)
+    // Variables
+    const double triangle_side = shapeSideLength(TRIANGLE);
+
+    const double triangle_hypotenuse = cx::sqrt(triangle_side * triangle_side * 2);
+
+    const double triangle_height = cx::sqrt(triangle_side * triangle_side - (triangle_hypotenuse / 2) * (triangle_hypotenuse / 2));
+
+    const double centroid = (triangle_side / 3);  // Triangle is isosceles so the x and y centroids are equal
+
+    const double triangle_centroid_diagonal = cx::sqrt(2 * centroid * centroid);
+
+    // Positioning
+    const double first_triangle_x_offset = -(square_diagonal / 2 - centroid) + square_x_offset;
+
+    const double first_triangle_y_offset = -(triangle_side - centroid) + square_y_offset;
+
+
+    // Second triangle calculations (Cyan triangle)
+    // Variables
+    const double second_triangle_side = SMALL_TRIANGLE_RATIO * triangle_side;
+
+    const double second_triangle_hypotenuse = cx::sqrt(second_triangle_side * second_triangle_side * 2);
+
+    const double second_triangle_centroid = (second_triangle_side / 3);
+
+    const double second_triangle_height = cx::sqrt(second_triangle_side * second_triangle_side - (second_triangle_hypotenuse / 2) * (second_triangle_hypotenuse / 2));
+
+    const double second_triangle_centroid_diagonal = cx::sqrt(2 * second_triangle_centroid * second_triangle_centroid);
+
+    // Positioning
+    const double second_triangle_x_offset = -(centroid - (second_triangle_height - second_triangle_centroid_diagonal)) + first_triangle_x_offset;
+
+    const double second_triangle_y_offset = (triangle_side + (second_triangle_hypotenuse / 2 - centroid)) + first_triangle_y_offset;
+
+
+    // Third triangle calculations (Light Blue triangle)
+    // Variables
+    const double third_triangle_hypotenuse = triangle_hypotenuse;
+
+    const double third_triangle_centroid_diagonal = triangle_centroid_diagonal;
+
+    const double third_triangle_height = triangle_height;
+
+    // Positioning
+    const double third_triangle_x_offset = third_triangle_hypotenuse / 2 + square_x_offset;
+
+    const double third_triangle_y_offset = -(square_diagonal / 2 - (third_triangle_height - third_triangle_centroid_diagonal)) + square_y_offset;
+
+
+    // Fourth triangle calculations (Purple triangle)
+    // Variables
+    const double fourth_triangle_side = triangle_side * MEDIUM_TRIANGLE_RATIO;
+
+    const double fourth_triangle_centroid = (fourth_triangle_side / 3);
+
+    // Positioning
+    const double fourth_triangle_x_offset = -fourth_triangle_centroid + square_x_offset;
+
+    const double fourth_triangle_y_offset = (fourth_triangle_side - fourth_triangle_centroid) + (square_diagonal / 2) + square_y_offset;
+
+
+    // Fifth triangle calculations (Red triangle)
+    // Variables
+    const double fifth_triangle_centroid_diagonal = second_triangle_centroid_diagonal;
+
+    const double fifth_triangle_height = second_triangle_height;
+
+    // Positioning
+    const double fifth_triangle_x_offset = -(fourth_triangle_side - fourth_triangle_centroid) + fourth_triangle_x_offset;
+
+    const double fifth_triangle_y_offset = -(fifth_triangle_height - (fourth_triangle_centroid + (fifth_triangle_height - fifth_triangle_centroid_diagonal))) + fourth_triangle_y_offset;
+
+
+    //Parallelogram
+    // Variables
+    const double parallelogram_side = shapeSideLength(PARALLELOGRAM) * PARALLELOGRAM_RATIO;
+
+    const double parallelogram_heigth = parallelogram_side * cx::sin(cx::radians(45.0));
+
+    // Positioning
+    const double parallelogram_x_offset = (triangle_side - centroid / 2) + first_triangle_x_offset;
+
+    const double parallelogram_y_offset = -(centroid + parallelogram_heigth / 2) + first_triangle_y_offset;
+
+
+    // Pieces are in mesh order, the rotation is the one that fits each piece in the dragon
+    return {{
+        {TRIANGLE, float(first_triangle_x_offset), float(first_triangle_y_offset), 0.0f, 1.0f,
+            {1.0f, 0.0f, 1.0f, 1.0f}}, // Magenta
+        {TRIANGLE, float(second_triangle_x_offset), float(second_triangle_y_offset), 135.0f, SMALL_TRIANGLE_RATIO,
+            {0.0f, 1.0f, 1.0f, 1.0f}}, // Cyan
+        {TRIANGLE, float(third_triangle_x_offset), float(third_triangle_y_offset), -135.0f, 1.0f,
+            {0.3f, 0.6f, 1.0f, 1.0f}}, // Light Blue
+        {TRIANGLE, float(fourth_triangle_x_offset), float(fourth_triangle_y_offset), 180.0f, MEDIUM_TRIANGLE_RATIO,
+            {0.5f, 0.0f, 0.5f, 1.0f}}, // Purple
+        {TRIANGLE, float(fifth_triangle_x_offset), float(fifth_triangle_y_offset), -135.0f, SMALL_TRIANGLE_RATIO,
+            {1.0f, 0.0f, 0.0f, 1.0f}}, // Red
+        {SQUARE, float(square_x_offset), float(square_y_offset), 45.0f, SQUARE_RATIO,
+            {0.0f, 0.7f, 0.0f, 1.0f}}, // Green
+        {PARALLELOGRAM, float(parallelogram_x_offset), float(parallelogram_y_offset), 0.0f, PARALLELOGRAM_RATIO,
+            {1.0f, 0.5f, 0.0f, 1.0f}} // Orange
+    }};
+}
+
+constexpr std::array<PieceLayout, 7> DRAGON_LAYOUT = makeDragonLayout();
+
+// global rotation * global scale * translate * rotate * scale
+constexpr cx::Mat4 pieceMatrix(const PieceLayout& piece, double global_scale, double global_rotation) {
+    return cx::rotate(global_rotation) * cx::scale(global_scale, global_scale)
+        * cx::translate(piece.x, piece.y) * cx::rotate(piece.rotation) * cx::scale(piece.scale, piece.scale);
+}
+
+template <std::size_t N>
+constexpr std::array<cx::Mat4, N> composeMatrices(const std::array<PieceLayout, N>& layout,
+    double global_scale, double global_rotation) {
+    std::array<cx::Mat4, N> matrices = {};
+    for (std::size_t i = 0; i < N; i++) {
+        matrices[i] = pieceMatrix(layout[i], global_scale, global_rotation);
+    }
+    return matrices;
+}
+
+constexpr std::array<cx::Mat4, 7> DRAGON_MATRICES =
+    composeMatrices(DRAGON_LAYOUT, DEFAULT_GLOBAL_SCALE, DEFAULT_GLOBAL_ROTATION);
+
+constexpr double pieceArea(const PieceLayout& piece) {
+    const double area = piece.mesh == TRIANGLE ? shapeArea(TRIANGLE_VERTICES)
+        : piece.mesh == SQUARE ? shapeArea(SQUARE_VERTICES)
+        : shapeArea(PARALLELOGRAM_VERTICES);
+    return area * piece.scale * piece.scale;
+}
+
+// Tangram proportions
+static_assert(cx::nearlyEqual(shapeSideLength(TRIANGLE), 1.0), "Triangle mesh must have unit legs");
+static_assert(cx::nearlyEqual(shapeSideLength(SQUARE), 1.0), "Square mesh must have unit sides");
+static_assert(cx::nearlyEqual(shapeSideLength(PARALLELOGRAM), 1.0), "Parallelogram mesh must have a unit side");
+static_assert(cx::nearlyEqual(MEDIUM_TRIANGLE_RATIO * MEDIUM_TRIANGLE_RATIO, 0.5), "Medium triangle must have half the area of a large one");
+// Large triangles are a quarter of the tangram, every other piece an eighth except the small triangles (a sixteenth)
+static_assert(cx::nearlyEqual(pieceArea(DRAGON_LAYOUT[0]), 2 * pieceArea(DRAGON_LAYOUT[3])), "Large and medium triangle areas");
+static_assert(cx::nearlyEqual(pieceArea(DRAGON_LAYOUT[1]), pieceArea(DRAGON_LAYOUT[3]) / 2), "Small and medium triangle areas");
+static_assert(cx::nearlyEqual(pieceArea(DRAGON_LAYOUT[4]), pieceArea(DRAGON_LAYOUT[1])), "Small triangles must match");
+static_assert(cx::nearlyEqual(pieceArea(DRAGON_LAYOUT[2]), pieceArea(DRAGON_LAYOUT[0])), "Large triangles must match");
+static_assert(cx::nearlyEqual(pieceArea(DRAGON_LAYOUT[5]), pieceArea(DRAGON_LAYOUT[3])), "Square must match the medium triangle");
+static_assert(cx::nearlyEqual(pieceArea(DRAGON_LAYOUT[6]), pieceArea(DRAGON_LAYOUT[3])), "Parallelogram must match the medium triangle");
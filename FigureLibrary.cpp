@@ -0,0 +1,315 @@
+#include "FigureLibrary.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+struct PieceType {
+    int mesh;
+    float scale;
+};
+
+static constexpr PieceType PIECE_TYPES[PIECE_TYPE_COUNT] = {
+    {TRIANGLE, 1.0f},
+    {TRIANGLE, MEDIUM_TRIANGLE_RATIO},
+    {TRIANGLE, SMALL_TRIANGLE_RATIO},
+    {SQUARE, SQUARE_RATIO},
+    {PARALLELOGRAM, PARALLELOGRAM_RATIO}
+};
+
+std::uint32_t figureNameHash(const std::string& name) {
+    std::uint32_t hash = 2166136261u;
+    for (const char c : name) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+    }
+    return hash;
+}
+
+////////////////////////////////////////////////////////////////////// LIBRARY
+
+#ifdef _WIN32
+FigureLibrary::FigureLibrary()
+    : data(nullptr), data_size(0), directory(nullptr), figure_count(0),
+      file_handle(INVALID_HANDLE_VALUE), mapping_handle(nullptr) {}
+#else
+FigureLibrary::FigureLibrary() : data(nullptr), data_size(0), directory(nullptr), figure_count(0) {}
+#endif
+
+FigureLibrary::~FigureLibrary() { close(); }
+
+void FigureLibrary::open(const std::string& filename) {
+    close();
+#ifdef _WIN32
+    file_handle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_handle == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Failed to open figure library.");
+    }
+    LARGE_INTEGER file_size;
+    GetFileSizeEx(file_handle, &file_size);
+    data_size = static_cast<std::size_t>(file_size.QuadPart);
+    mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_handle) {
+        data = static_cast<const unsigned char*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+    }
+#else
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open figure library.");
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+        data_size = static_cast<std::size_t>(file_stat.st_size);
+        void* mapping = mmap(nullptr, data_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        data = mapping == MAP_FAILED ? nullptr : static_cast<const unsigned char*>(mapping);
+    }
+    ::close(fd); // The mapping keeps the file alive
+#endif
+    if (!data) {
+        close();
+        throw std::runtime_error("Failed to map figure library.");
+    }
+
+    const FigureLibraryHeader* header = reinterpret_cast<const FigureLibraryHeader*>(
+        at(0, sizeof(FigureLibraryHeader), alignof(FigureLibraryHeader)));
+    if (!header || header->magic != FIGURE_LIBRARY_MAGIC || header->version != FIGURE_LIBRARY_VERSION) {
+        close();
+        throw std::runtime_error("Invalid figure library.");
+    }
+    directory = reinterpret_cast<const FigureRecord*>(
+        at(header->directory_offset, std::size_t(header->figure_count) * sizeof(FigureRecord), alignof(FigureRecord)));
+    if (!directory) {
+        close();
+        throw std::runtime_error("Truncated figure library.");
+    }
+    figure_count = header->figure_count;
+}
+
+void FigureLibrary::close() {
+#ifdef _WIN32
+    if (data) {
+        UnmapViewOfFile(data);
+    }
+    if (mapping_handle) {
+        CloseHandle(mapping_handle);
+    }
+    if (file_handle != INVALID_HANDLE_VALUE) {
+        CloseHandle(file_handle);
+    }
+    mapping_handle = nullptr;
+    file_handle = INVALID_HANDLE_VALUE;
+#else
+    if (data) {
+        munmap(const_cast<unsigned char*>(data), data_size);
+    }
+#endif
+    data = nullptr;
+    data_size = 0;
+    directory = nullptr;
+    figure_count = 0;
+}
+
+const unsigned char* FigureLibrary::at(std::uint32_t offset, std::size_t size, std::size_t alignment) const {
+    // Records are read in place, so they must be aligned as their type
+    if (offset > data_size || size > data_size - offset || offset % alignment != 0) {
+        return nullptr;
+    }
+    return data + offset;
+}
+
+FigureView FigureLibrary::getFigure(std::size_t index) const {
+    if (index >= figure_count) {
+        throw std::out_of_range("Invalid figure index");
+    }
+    const FigureRecord& record = directory[index];
+    FigureView figure;
+    // The name must end within the library, or it could not be read as a string
+    const unsigned char* name = at(record.name_offset, 1);
+    if (name && std::memchr(name, '\0', data_size - record.name_offset)) {
+        figure.name = reinterpret_cast<const char*>(name);
+    }
+    else {
+        figure.name = nullptr;
+    }
+    figure.pieces = reinterpret_cast<const PieceRecord*>(
+        at(record.piece_offset, std::size_t(record.piece_count) * sizeof(PieceRecord), alignof(PieceRecord)));
+    figure.matrices = (record.flags & FIGURE_HAS_MATRICES)
+        ? reinterpret_cast<const float*>(
+            at(record.matrix_offset, std::size_t(record.piece_count) * 16 * sizeof(float), alignof(float)))
+        : nullptr;
+    figure.piece_count = record.piece_count;
+    figure.global_scale = record.global_scale;
+    figure.global_rotation = record.global_rotation;
+    if (!figure.name || !figure.pieces || ((record.flags & FIGURE_HAS_MATRICES) && !figure.matrices)) {
+        throw std::runtime_error("Truncated or corrupt figure library.");
+    }
+    return figure;
+}
+
+bool FigureLibrary::findFigure(const std::string& name, FigureView& figure) const {
+    const std::uint32_t hash = figureNameHash(name);
+    const FigureRecord* end = directory + figure_count;
+    const FigureRecord* record = std::lower_bound(directory, end, hash,
+        [](const FigureRecord& r, std::uint32_t h) { return r.name_hash < h; });
+    // Hash collisions are resolved by comparing the names
+    for (; record != end && record->name_hash == hash; record++) {
+        const FigureView candidate = getFigure(static_cast<std::size_t>(record - directory));
+        if (std::strcmp(candidate.name, name.c_str()) == 0) {
+            figure = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+/////////////////////////////////////////////////////////////////////// PIECES
+
+void checkFigure(const FigureView& figure) {
+    for (std::size_t i = 0; i < figure.piece_count; i++) {
+        if (figure.pieces[i].type >= PIECE_TYPE_COUNT) {
+            throw std::runtime_error("Invalid piece type in figure library.");
+        }
+    }
+}
+
+void loadFigure(const FigureView& figure, PieceTable& pieces, float global_scale, float global_rotation) {
+    // Checked before the table is touched, so that it is left as it was
+    checkFigure(figure);
+    pieces.clear();
+    for (std::size_t i = 0; i < figure.piece_count; i++) {
+        const PieceRecord& piece = figure.pieces[i];
+        const PieceType& type = PIECE_TYPES[piece.type];
+        pieces.add(type.mesh,
+            glm::vec2(piece.lattice_x / LATTICE_UNITS, piece.lattice_y / LATTICE_UNITS),
+            piece.orientation * ORIENTATION_STEP, type.scale,
+            glm::vec4(piece.color[0], piece.color[1], piece.color[2], piece.color[3]) / 255.0f);
+    }
+    // Stored matrices follow the stored piece order, so they are only valid if no sort is needed
+    if (figure.matrices && figure.global_scale == global_scale && figure.global_rotation == global_rotation
+        && pieces.isSortedByMesh()) {
+        glm::mat4* matrices = pieces.getMatrices();
+        for (std::size_t i = 0; i < figure.piece_count; i++) {
+            matrices[i] = glm::make_mat4(figure.matrices + 16 * i);
+        }
+        pieces.clearDirty();
+    }
+    else {
+        pieces.sortByMesh();
+    }
+}
+
+////////////////////////////////////////////////////////////////////// WRITING
+
+static std::uint8_t pieceType(const PieceLayout& piece) {
+    std::uint8_t best = PIECE_LARGE_TRIANGLE;
+    for (std::uint8_t type = 0; type < PIECE_TYPE_COUNT; type++) {
+        if (PIECE_TYPES[type].mesh == piece.mesh
+            && (PIECE_TYPES[best].mesh != piece.mesh
+                || std::abs(PIECE_TYPES[type].scale - piece.scale) < std::abs(PIECE_TYPES[best].scale - piece.scale))) {
+            best = type;
+        }
+    }
+    return best;
+}
+
+static PieceRecord pieceRecord(const PieceLayout& piece) {
+    PieceRecord record = {};
+    record.type = pieceType(piece);
+    const long orientation = std::lround(piece.rotation / ORIENTATION_STEP);
+    record.orientation = static_cast<std::uint8_t>(((orientation % 8) + 8) % 8);
+    record.lattice_x = static_cast<std::int16_t>(std::lround(piece.x * LATTICE_UNITS));
+    record.lattice_y = static_cast<std::int16_t>(std::lround(piece.y * LATTICE_UNITS));
+    for (int i = 0; i < 4; i++) {
+        record.color[i] = static_cast<std::uint8_t>(std::lround(glm::clamp(piece.color[i], 0.0f, 1.0f) * 255.0f));
+    }
+    return record;
+}
+
+// The layout a record decodes to, so the stored matrices match the loaded pieces.
+static PieceLayout decodedLayout(const PieceRecord& record) {
+    const PieceType& type = PIECE_TYPES[record.type];
+    return {type.mesh, record.lattice_x / LATTICE_UNITS, record.lattice_y / LATTICE_UNITS,
+        record.orientation * ORIENTATION_STEP, type.scale, {0.0f, 0.0f, 0.0f, 0.0f}};
+}
+
+void writeFigureLibrary(const std::string& filename, const std::vector<FigureDescription>& figures) {
+    std::vector<std::size_t> order(figures.size());
+    for (std::size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&figures](std::size_t a, std::size_t b) {
+        return figureNameHash(figures[a].name) < figureNameHash(figures[b].name);
+    });
+
+    FigureLibraryHeader header = {FIGURE_LIBRARY_MAGIC, FIGURE_LIBRARY_VERSION,
+        static_cast<std::uint32_t>(figures.size()), sizeof(FigureLibraryHeader)};
+    std::vector<FigureRecord> directory;
+    std::vector<PieceRecord> piece_records;
+    std::vector<float> matrices;
+    std::string names;
+
+    for (const std::size_t index : order) {
+        const FigureDescription& figure = figures[index];
+        // Pieces are stored in mesh order so that they load straight into a sorted table
+        std::vector<PieceLayout> layout = figure.pieces;
+        std::stable_sort(layout.begin(), layout.end(),
+            [](const PieceLayout& a, const PieceLayout& b) { return a.mesh < b.mesh; });
+
+        FigureRecord record = {};
+        record.name_hash = figureNameHash(figure.name);
+        record.name_offset = static_cast<std::uint32_t>(names.size());
+        record.piece_offset = static_cast<std::uint32_t>(piece_records.size() * sizeof(PieceRecord));
+        record.matrix_offset = static_cast<std::uint32_t>(matrices.size() * sizeof(float));
+        record.piece_count = static_cast<std::uint16_t>(layout.size());
+        record.flags = FIGURE_HAS_MATRICES;
+        record.global_scale = DEFAULT_GLOBAL_SCALE;
+        record.global_rotation = DEFAULT_GLOBAL_ROTATION;
+        for (const PieceLayout& piece : layout) {
+            const PieceRecord piece_record = pieceRecord(piece);
+            piece_records.push_back(piece_record);
+            const cx::Mat4 matrix = pieceMatrix(decodedLayout(piece_record), DEFAULT_GLOBAL_SCALE, DEFAULT_GLOBAL_ROTATION);
+            matrices.insert(matrices.end(), &matrix.m[0][0], &matrix.m[0][0] + 16);
+        }
+        directory.push_back(record);
+        names += figure.name;
+        names += '\0';
+    }
+
+    // Relocate the offsets now that the section sizes are known
+    const std::uint32_t pieces_start = static_cast<std::uint32_t>(sizeof(FigureLibraryHeader) + directory.size() * sizeof(FigureRecord));
+    const std::uint32_t matrices_start = static_cast<std::uint32_t>(pieces_start + piece_records.size() * sizeof(PieceRecord));
+    const std::uint32_t names_start = static_cast<std::uint32_t>(matrices_start + matrices.size() * sizeof(float));
+    for (FigureRecord& record : directory) {
+        record.piece_offset += pieces_start;
+        record.matrix_offset += matrices_start;
+        record.name_offset += names_start;
+    }
+
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to create figure library.");
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(directory.data()), directory.size() * sizeof(FigureRecord));
+    file.write(reinterpret_cast<const char*>(piece_records.data()), piece_records.size() * sizeof(PieceRecord));
+    file.write(reinterpret_cast<const char*>(matrices.data()), matrices.size() * sizeof(float));
+    file.write(names.data(), names.size());
+    if (!file) {
+        throw std::runtime_error("Failed to write figure library.");
+    }
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "DragonLayout.h"
+#include "PieceTable.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* Binary figure library (.tgl), little-endian:
+
+	FigureLibraryHeader
+	FigureRecord[figure_count]   directory, sorted by name hash
+	PieceRecord[...]             pieces of every figure, in mesh order
+	float[16][...]               optional precomputed piece matrices
+	char[...]                    null-terminated figure names
+
+   Opening a library maps the file and only checks the header, so it does
+   not depend on the library size. Figures are handed out as views into the
+   mapping and are never copied or parsed.
+*/
+
+constexpr std::uint32_t FIGURE_LIBRARY_MAGIC = 0x4C464754; // "TGFL"
+constexpr std::uint32_t FIGURE_LIBRARY_VERSION = 1;
+
+// Pieces positions are on a lattice of 1/LATTICE_UNITS of the large triangle leg.
+constexpr float LATTICE_UNITS = 4096.0f;
+// Orientations are multiples of 45 degrees.
+constexpr float ORIENTATION_STEP = 45.0f;
+
+// The seven piece types of the tangram, each one a mesh at a fixed scale.
+constexpr std::uint8_t PIECE_LARGE_TRIANGLE = 0;
+constexpr std::uint8_t PIECE_MEDIUM_TRIANGLE = 1;
+constexpr std::uint8_t PIECE_SMALL_TRIANGLE = 2;
+constexpr std::uint8_t PIECE_SQUARE = 3;
+constexpr std::uint8_t PIECE_PARALLELOGRAM = 4;
+constexpr std::uint8_t PIECE_TYPE_COUNT = 5;
+
+constexpr std::uint16_t FIGURE_HAS_MATRICES = 1;
+
+struct FigureLibraryHeader {
+	std::uint32_t magic;
+	std::uint32_t version;
+	std::uint32_t figure_count;
+	std::uint32_t directory_offset;
+};
+
+struct FigureRecord {
+	std::uint32_t name_hash;     // FNV-1a of the name
+	std::uint32_t name_offset;
+	std::uint32_t piece_offset;
+	std::uint32_t matrix_offset; // Matrices for global_scale and global_rotation, if FIGURE_HAS_MATRICES
+	std::uint16_t piece_count;
+	std::uint16_t flags;
+	float global_scale;
+	float global_rotation;
+	std::uint32_t reserved;
+};
+
+struct PieceRecord {
+	std::uint8_t type;
+	std::uint8_t orientation; // In ORIENTATION_STEP units
+	std::uint8_t reserved[2];
+	std::int16_t lattice_x, lattice_y;
+	std::uint8_t color[4];    // RGBA8
+};
+
+static_assert(sizeof(FigureLibraryHeader) == 16, "Unexpected figure library header size");
+static_assert(sizeof(FigureRecord) == 32, "Unexpected figure record size");
+static_assert(sizeof(PieceRecord) == 12, "Unexpected piece record size");
+
+// Zero-copy view of a figure inside a mapped library.
+struct FigureView {
+	const char* name; // Null-terminated within the mapping
+	const PieceRecord* pieces;
+	const float* matrices; // nullptr when the figure has no precomputed matrices
+	std::size_t piece_count;
+	float global_scale;
+	float global_rotation;
+};
+
+std::uint32_t figureNameHash(const std::string& name);
+
+class FigureLibrary {
+	private:
+		const unsigned char* data;
+		std::size_t data_size;
+		const FigureRecord* directory;
+		std::size_t figure_count;
+#ifdef _WIN32
+		void* file_handle;
+		void* mapping_handle;
+#endif
+
+		// nullptr unless [offset, offset + size) is in the library and offset is a
+		// multiple of alignment.
+		const unsigned char* at(std::uint32_t offset, std::size_t size, std::size_t alignment = 1) const;
+
+	public:
+		FigureLibrary();
+		~FigureLibrary();
+		FigureLibrary(const FigureLibrary&) = delete;
+		FigureLibrary& operator=(const FigureLibrary&) = delete;
+
+		void open(const std::string& filename);
+		void close();
+		bool isOpen() const { return data != nullptr; }
+
+		std::size_t size() const { return figure_count; }
+		FigureView getFigure(std::size_t index) const;
+		// Binary search on the name hash. Returns false if there is no such figure.
+		bool findFigure(const std::string& name, FigureView& figure) const;
+};
+
+// Throws if a piece of the figure cannot be loaded.
+void checkFigure(const FigureView& figure);
+// Fills the table with the pieces of a figure. Precomputed matrices are used
+// when they were made for the given global scale and rotation.
+void loadFigure(const FigureView& figure, PieceTable& pieces, float global_scale = DEFAULT_GLOBAL_SCALE,
+	float global_rotation = DEFAULT_GLOBAL_ROTATION);
+
+struct FigureDescription {
+	std::string name;
+	std::vector<PieceLayout> pieces;
+};
+
+// Writes a library, with precomputed matrices for the default global transformation.
+void writeFigureLibrary(const std::string& filename, const std::vector<FigureDescription>& figures);
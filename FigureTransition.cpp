@@ -0,0 +1,89 @@
+#include "FigureTransition.h"
+#include <algorithm>
+#include <stdexcept>
+
+
+// glm::mix, but exact when both ends are the same, so that pieces that do not
+// move are not marked as changed every frame.
+template <typename T>
+static T interpolate(const T& from, const T& to, float t) {
+    return from == to ? from : glm::mix(from, to, t);
+}
+
+FigureTransition::FigureTransition(double duration)
+    : duration(duration), previous(1.0), current(1.0), active(false) {
+    if (duration <= 0.0) {
+        throw std::invalid_argument("Transition duration must be positive");
+    }
+}
+
+void FigureTransition::capture(const PieceTable& pieces) {
+    from_positions.clear();
+    from_rotations.clear();
+    from_scales.clear();
+    from_meshes.clear();
+    for (PieceId id = 0; id < pieces.size(); id++) {
+        from_positions.push_back(pieces.getPosition(id));
+        from_rotations.push_back(pieces.getRotation(id));
+        from_scales.push_back(pieces.getScale(id));
+        from_meshes.push_back(pieces.getMesh(id));
+    }
+}
+
+bool FigureTransition::start(PieceTable& pieces) {
+    active = false;
+    if (from_meshes.size() != pieces.size()) {
+        return false;
+    }
+    for (PieceId id = 0; id < pieces.size(); id++) {
+        if (from_meshes[id] != pieces.getMesh(id)) {
+            return false;
+        }
+    }
+    to_positions.clear();
+    to_rotations.clear();
+    to_scales.clear();
+    for (PieceId id = 0; id < pieces.size(); id++) {
+        to_positions.push_back(pieces.getPosition(id));
+        // The shorter way around
+        float rotation = pieces.getRotation(id);
+        while (rotation - from_rotations[id] > 180.0f) {
+            rotation -= 360.0f;
+        }
+        while (rotation - from_rotations[id] < -180.0f) {
+            rotation += 360.0f;
+        }
+        to_rotations.push_back(rotation);
+        to_scales.push_back(pieces.getScale(id));
+    }
+    previous = current = 0.0;
+    active = true;
+    apply(pieces, 0.0);
+    return true;
+}
+
+void FigureTransition::update(double step) {
+    if (active) {
+        previous = current;
+        current = std::min(current + step / duration, 1.0);
+    }
+}
+
+bool FigureTransition::apply(PieceTable& pieces, double alpha) {
+    if (!active) {
+        return false;
+    }
+    const double progress = previous + (current - previous) * alpha;
+    // Eases in and out
+    const float t = static_cast<float>(progress * progress * (3.0 - 2.0 * progress));
+    for (PieceId id = 0; id < pieces.size(); id++) {
+        pieces.setPosition(id, interpolate(from_positions[id], to_positions[id], t));
+        pieces.setRotation(id, interpolate(from_rotations[id], to_rotations[id], t));
+        pieces.setScale(id, interpolate(from_scales[id], to_scales[id], t));
+    }
+    // The last step may land between frames, the pose is only final once drawn
+    if (previous >= 1.0) {
+        active = false;
+    }
+    return active;
+}
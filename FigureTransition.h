@@ -0,0 +1,43 @@
+#pragma once
+
+#include "../mgl/mgl.hpp"
+#include "PieceTable.h"
+#include <vector>
+
+// Moves the pieces from one figure to the next over a fixed duration, instead
+// of the new figure popping in. The progress only advances in update(), by the
+// fixed steps of the Engine, so a transition takes as many steps at any frame
+// rate; apply() poses the pieces between the last two steps.
+//
+//   transition.capture(pieces);        // before the figure is replaced
+//   loadFigure(figure, pieces);
+//   transition.start(pieces);
+//   ...
+//   transition.update(step);           // updateCallback
+//   transition.apply(pieces, alpha);   // displayCallback
+class FigureTransition {
+	private:
+		std::vector<glm::vec2> from_positions, to_positions;
+		std::vector<float> from_rotations, to_rotations; // Degrees
+		std::vector<float> from_scales, to_scales;
+		std::vector<int> from_meshes;
+		double duration; // Seconds
+		double previous, current; // Progress, from 0 to 1, before and after the last step
+		bool active;
+
+	public:
+		explicit FigureTransition(double duration = 0.4);
+
+		// Keeps the poses of the pieces of the figure being replaced.
+		void capture(const PieceTable& pieces);
+		// Starts moving from the captured poses to those now in the table, and
+		// poses the pieces as captured. Pieces are matched by row, so there is no
+		// transition unless every row holds the same mesh in both figures.
+		bool start(PieceTable& pieces);
+		void update(double step);
+		// Poses the pieces alpha of the way from the previous step to the current
+		// one. Returns false once they rest on the new figure.
+		bool apply(PieceTable& pieces, double alpha);
+
+		bool isActive() const { return active; }
+};
@@ -0,0 +1,140 @@
+#include "FillBenchmark.h"
+
+#include "PieceRenderer.h"
+#include "PieceTable.h"
+#include "TransformCache.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+// Enough large pieces to cover the screen about ten times
+constexpr int BENCHMARK_PIECES = 256;
+constexpr float BENCHMARK_SCALE = 0.6f;
+
+struct BenchmarkTarget {
+    GLuint framebuffer, color, depth;
+};
+
+static BenchmarkTarget createTarget(int width, int height, int samples) {
+    BenchmarkTarget target = {};
+    glCreateRenderbuffers(1, &target.color);
+    glNamedRenderbufferStorageMultisample(target.color, samples, GL_RGBA8, width, height);
+    glCreateRenderbuffers(1, &target.depth);
+    glNamedRenderbufferStorageMultisample(target.depth, samples, GL_DEPTH24_STENCIL8, width, height);
+    glCreateFramebuffers(1, &target.framebuffer);
+    glNamedFramebufferRenderbuffer(target.framebuffer, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target.color);
+    glNamedFramebufferRenderbuffer(target.framebuffer, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, target.depth);
+    if (glCheckNamedFramebufferStatus(target.framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        throw std::runtime_error("Incomplete benchmark framebuffer");
+    }
+    return target;
+}
+
+static void destroyTarget(BenchmarkTarget& target) {
+    mgl::StateCache::getInstance().forgetFramebuffer(target.framebuffer);
+    glDeleteFramebuffers(1, &target.framebuffer);
+    glDeleteRenderbuffers(1, &target.color);
+    glDeleteRenderbuffers(1, &target.depth);
+}
+
+static void layoutBenchmark(PieceTable& pieces) {
+    std::mt19937 random(2025);
+    std::uniform_real_distribution<float> position(-1.0f, 1.0f), angle(0.0f, 360.0f), channel(0.2f, 1.0f);
+    for (int i = 0; i < BENCHMARK_PIECES; i++) {
+        pieces.add(i % SHAPE_COUNT, glm::vec2(position(random), position(random)), angle(random), BENCHMARK_SCALE,
+            glm::vec4(channel(random), channel(random), channel(random), 1.0f));
+    }
+    pieces.sortByMesh();
+}
+
+static double median(std::vector<double>& values) {
+    std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+    return values[values.size() / 2];
+}
+
+void runFillBenchmark(GeometryBuffer& meshes, mgl::ShaderProgram& mesh_program, SdfPieces& sdf,
+    mgl::ShaderProgram& sdf_program, int width, int height, int frames) {
+    PieceTable pieces;
+    layoutBenchmark(pieces);
+    TransformCache transforms;
+    transforms.setGlobalScale(1.0f);
+    transforms.setGlobalRotation(0.0f);
+    transforms.update(pieces);
+
+    PieceRenderer mesh_renderer(meshes), sdf_renderer(sdf.getGeometry());
+    mesh_renderer.update(pieces, transforms);
+    sdf_renderer.update(pieces, transforms);
+    mgl::RenderQueue queue;
+    mgl::StateCache& state = mgl::StateCache::getInstance();
+    const GLuint previous_framebuffer = state.getFramebuffer();
+    BenchmarkTarget resolved = createTarget(width, height, 0);
+
+    GLint max_samples = 0;
+    glGetIntegerv(GL_MAX_SAMPLES, &max_samples);
+    std::cout << "Fill benchmark: " << BENCHMARK_PIECES << " pieces at " << width << "x" << height << ", median of "
+              << frames << " frames" << std::endl;
+
+    for (int samples : {0, 4, 8, -1}) {
+        const bool use_sdf = samples < 0;
+        if (samples > max_samples) {
+            std::cout << "  MSAA " << samples << "x not supported" << std::endl;
+            continue;
+        }
+        BenchmarkTarget target = samples > 0 ? createTarget(width, height, samples) : resolved;
+        std::vector<GLuint> queries(frames);
+        std::vector<double> wall_times;
+        glGenQueries(frames, queries.data());
+        for (int frame = 0; frame < frames; frame++) {
+            const auto start = std::chrono::steady_clock::now();
+            glBeginQuery(GL_TIME_ELAPSED, queries[frame]);
+            state.bindFramebuffer(target.framebuffer);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+            if (use_sdf) {
+                sdf.bind(sdf_program, width, height);
+                sdf_renderer.submit(queue, sdf_program);
+            }
+            else {
+                state.disable(GL_BLEND);
+                mesh_renderer.submit(queue, mesh_program);
+            }
+            queue.sort();
+            queue.flush();
+            if (samples > 0) {
+                glBlitNamedFramebuffer(target.framebuffer, resolved.framebuffer, 0, 0, width, height, 0, 0, width,
+                    height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            }
+            glEndQuery(GL_TIME_ELAPSED);
+            glFinish();
+            wall_times.push_back(
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        mesh_renderer.fence();
+        sdf_renderer.fence();
+
+        std::vector<double> gpu_times;
+        for (GLuint query : queries) {
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+            gpu_times.push_back(nanoseconds / 1.0e6);
+        }
+        glDeleteQueries(frames, queries.data());
+        const std::string name = use_sdf ? "SDF, coverage AA" : samples == 0 ? "Meshes, aliased"
+            : "Meshes, MSAA " + std::to_string(samples) + "x";
+        std::ostringstream line;
+        line << "  " << std::left << std::setw(20) << name << std::right << std::fixed << std::setprecision(3)
+             << std::setw(9) << median(gpu_times) << " ms GPU" << std::setw(9) << median(wall_times) << " ms wall";
+        std::cout << line.str() << std::endl;
+        if (samples > 0) {
+            destroyTarget(target);
+        }
+    }
+    state.bindFramebuffer(previous_framebuffer);
+    destroyTarget(resolved);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "../mgl/mgl.hpp"
+#include "GeometryBuffer.h"
+#include "SdfPieces.h"
+
+// Fill cost of the antialiasing options: draws the same screen of large,
+// overlapping pieces offscreen with
+//   - the shape meshes into a single-sample framebuffer (aliased),
+//   - the shape meshes into 4x and 8x multisampled framebuffers, resolved to
+//     a single-sample one as a window would be,
+//   - the SDF quads into a single-sample framebuffer,
+// and prints the median time of a frame for each: GPU time measured with timer
+// queries, and wall time up to glFinish, since deferred renderers may do the
+// work outside the queries. Programs must have been checked against the
+// pieces' blocks.
+void runFillBenchmark(GeometryBuffer& meshes, mgl::ShaderProgram& mesh_program, SdfPieces& sdf,
+	mgl::ShaderProgram& sdf_program, int width, int height, int frames = 100);
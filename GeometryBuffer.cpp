@@ -0,0 +1,161 @@
+#include "GeometryBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+
+static std::vector<MeshData> shapeMeshes(const std::vector<Shape2D>& shapes) {
+    std::vector<MeshData> meshes;
+    for (const Shape2D& shape : shapes) {
+        meshes.push_back({shape.getVertices(), shape.getVertexCount(), shape.getIndices(), shape.getIndexCount()});
+    }
+    return meshes;
+}
+
+GeometryBuffer::GeometryBuffer(const std::vector<Shape2D>& shapes, VertexFormat format)
+    : GeometryBuffer(shapeMeshes(shapes), format) {}
+
+GeometryBuffer::GeometryBuffer(VertexFormat format)
+    : vao(0), vbo{0, 0}, format(format), vertex_size(0), index_size(0), vertex_capacity(0), index_capacity(0) {
+    vertexLayout(format); // Throws before any GL object is made
+    create();
+}
+
+GeometryBuffer::GeometryBuffer(const std::vector<MeshData>& mesh_data, VertexFormat format)
+    : GeometryBuffer(format) {
+    for (const MeshData& mesh : mesh_data) {
+        addMesh(mesh);
+    }
+    upload();
+}
+
+void GeometryBuffer::create() {
+    mgl::StateCache& state = mgl::StateCache::getInstance();
+    glGenVertexArrays(1, &vao);
+    state.bindVertexArray(vao);
+    setupVertexAttribute(GEOMETRY_POSITION, GEOMETRY_BINDING, format);
+    // Unbound so that no later element buffer binding ends up in it
+    state.bindVertexArray(0);
+}
+
+static GLenum indexType(int vertex_count) {
+    return vertex_count <= 0x100 ? GL_UNSIGNED_BYTE : vertex_count <= 0x10000 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+static std::size_t indexSize(GLenum type) {
+    return type == GL_UNSIGNED_BYTE ? sizeof(GLubyte) : type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+}
+
+int GeometryBuffer::addMesh(const MeshData& mesh) {
+    const std::vector<GLuint> indices(mesh.indices, mesh.indices + mesh.index_count);
+    return addMesh(mesh.vertices, mesh.vertex_count, indices.data(), mesh.index_count);
+}
+
+int GeometryBuffer::addMesh(const Vertex* vertices, int vertex_count, const GLuint* indices, int index_count) {
+    if (vertex_count <= 0 || index_count <= 0) {
+        throw std::invalid_argument("Empty mesh");
+    }
+    for (int i = 0; i < index_count; i++) {
+        if (indices[i] >= static_cast<GLuint>(vertex_count)) {
+            throw std::invalid_argument("Mesh index out of its vertices");
+        }
+    }
+    const GLuint stride = vertexLayout(format).stride;
+    const GLenum type = indexType(vertex_count);
+    const std::size_t size = indexSize(type);
+
+    // Padded so that the first index is a whole number of indices of its type
+    const std::size_t offset = (index_size + staged_indices.size() + size - 1) / size * size;
+    staged_indices.resize(offset - index_size + index_count * size);
+    GLubyte* out = staged_indices.data() + (offset - index_size);
+    for (int i = 0; i < index_count; i++, out += size) {
+        if (type == GL_UNSIGNED_BYTE) {
+            *out = static_cast<GLubyte>(indices[i]);
+        }
+        else if (type == GL_UNSIGNED_SHORT) {
+            const GLushort index = static_cast<GLushort>(indices[i]);
+            std::memcpy(out, &index, sizeof(index));
+        }
+        else {
+            std::memcpy(out, &indices[i], sizeof(GLuint));
+        }
+    }
+
+    const GLint base_vertex = static_cast<GLint>((vertex_size + staged_vertices.size()) / stride);
+    const std::vector<GLubyte> packed = packVertices(vertices, vertex_count, format);
+    staged_vertices.insert(staged_vertices.end(), packed.begin(), packed.end());
+
+    meshes.push_back({static_cast<GLuint>(offset / size), static_cast<GLuint>(index_count), base_vertex, type});
+    return static_cast<int>(meshes.size() - 1);
+}
+
+void GeometryBuffer::grow(GLuint& buffer, GLsizeiptr& capacity, GLsizeiptr used, GLsizeiptr needed) {
+    if (needed <= capacity) {
+        return;
+    }
+    // Doubling keeps the copies linear in the total size of the meshes
+    const GLsizeiptr new_capacity = std::max<GLsizeiptr>(capacity * 2, std::max<GLsizeiptr>(needed, 4096));
+    GLuint new_buffer = 0;
+    glCreateBuffers(1, &new_buffer);
+    glNamedBufferStorage(new_buffer, new_capacity, nullptr, GL_DYNAMIC_STORAGE_BIT);
+    if (used > 0) {
+        glCopyNamedBufferSubData(buffer, new_buffer, 0, 0, used);
+    }
+    if (buffer != 0) {
+        mgl::StateCache::getInstance().forgetBuffer(buffer);
+        glDeleteBuffers(1, &buffer);
+    }
+    buffer = new_buffer;
+    capacity = new_capacity;
+}
+
+void GeometryBuffer::upload() {
+    if (staged_vertices.empty()) {
+        return;
+    }
+    const GLuint stride = vertexLayout(format).stride;
+    const GLsizeiptr vertex_end = vertex_size + static_cast<GLsizeiptr>(staged_vertices.size());
+    const GLsizeiptr index_end = index_size + static_cast<GLsizeiptr>(staged_indices.size());
+    const GLuint old_vbo[2] = {vbo[0], vbo[1]};
+    grow(vbo[0], vertex_capacity, vertex_size, vertex_end);
+    grow(vbo[1], index_capacity, index_size, index_end);
+    if (vbo[0] != old_vbo[0]) {
+        glVertexArrayVertexBuffer(vao, GEOMETRY_BINDING, vbo[0], 0, stride);
+    }
+    if (vbo[1] != old_vbo[1]) {
+        glVertexArrayElementBuffer(vao, vbo[1]);
+    }
+    glNamedBufferSubData(vbo[0], vertex_size, vertex_end - vertex_size, staged_vertices.data());
+    glNamedBufferSubData(vbo[1], index_size, index_end - index_size, staged_indices.data());
+    vertex_size = vertex_end;
+    index_size = index_end;
+
+    // The GPU copy is the only one kept
+    std::vector<GLubyte>().swap(staged_vertices);
+    std::vector<GLubyte>().swap(staged_indices);
+}
+
+GeometryBuffer::~GeometryBuffer() { destroy(); }
+
+void GeometryBuffer::addTo(mgl::ShaderProgram& program) const {
+    program.addUniform(POSITION_SCALE_UNIFORM);
+}
+
+void GeometryBuffer::setUniforms(mgl::ShaderProgram& program) const {
+    program.set(program.getUniformId(POSITION_SCALE_UNIFORM), getPositionScale());
+}
+
+void GeometryBuffer::destroy() {
+    if (vao != 0) {
+        mgl::StateCache& state = mgl::StateCache::getInstance();
+        state.forgetVertexArray(vao);
+        state.forgetBuffer(vbo[0]);
+        state.forgetBuffer(vbo[1]);
+        glDeleteBuffers(2, vbo);
+        glDeleteVertexArrays(1, &vao);
+        vao = 0;
+        vbo[0] = vbo[1] = 0;
+        vertex_size = index_size = vertex_capacity = index_capacity = 0;
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "../mgl/mgl.hpp"
+#include "Shape2D.h"
+#include <vector>
+
+// Location of the range of a mesh inside the shared buffers, in the units of
+// a glDrawElementsBaseVertex call. first_index counts indices of index_type.
+struct MeshRange {
+	GLuint first_index;
+	GLuint index_count;
+	GLint base_vertex;
+	GLenum index_type;
+};
+
+// Layout of the commands read by glMultiDrawElementsIndirect.
+struct DrawElementsIndirectCommand {
+	GLuint count;
+	GLuint instance_count;
+	GLuint first_index;
+	GLint base_vertex;
+	GLuint base_instance;
+};
+
+// Vertices and indices of one mesh.
+struct MeshData {
+	const Vertex* vertices;
+	int vertex_count;
+	const GLubyte* indices;
+	int index_count;
+};
+
+// Vertex attribute locations and vertex buffer binding points of the shared VAO.
+constexpr GLuint GEOMETRY_POSITION = 0;
+constexpr GLuint GEOMETRY_BINDING = 0;
+
+// Uniform the vertex shader multiplies the position by, for the formats that
+// store positions scaled down. Defaults to 1.0 in the shader.
+const char POSITION_SCALE_UNIFORM[] = "PositionScale";
+
+// Arena holding the vertices and indices of every mesh in one vertex buffer
+// and one index buffer behind a single VAO, so that the whole scene can be
+// drawn without switching VAOs and without one GL object per mesh. Each mesh
+// is a range of indices relative to its base vertex. Its indices are stored
+// in the narrowest type that addresses its vertices, GLubyte, GLushort or
+// GLuint, aligned to their size so that first_index counts whole indices.
+// Positions are stored in the given format, see VertexFormat.h.
+// Meshes are staged on the CPU by addMesh() and copied to the GPU by upload(),
+// which grows the buffers if needed and frees the staging copies.
+class GeometryBuffer {
+	private:
+		GLuint vao, vbo[2];
+		VertexFormat format;
+		std::vector<MeshRange> meshes;
+		std::vector<GLubyte> staged_vertices, staged_indices;
+		GLsizeiptr vertex_size, index_size; // Uploaded bytes
+		GLsizeiptr vertex_capacity, index_capacity;
+
+		void create();
+		// Replaces the buffer by one of at least the given capacity holding the
+		// same first used bytes.
+		void grow(GLuint& buffer, GLsizeiptr& capacity, GLsizeiptr used, GLsizeiptr needed);
+
+	public:
+		explicit GeometryBuffer(VertexFormat format = VERTEX_FLOAT4);
+		explicit GeometryBuffer(const std::vector<MeshData>& mesh_data, VertexFormat format = VERTEX_FLOAT4);
+		explicit GeometryBuffer(const std::vector<Shape2D>& shapes, VertexFormat format = VERTEX_FLOAT4);
+		~GeometryBuffer();
+		GeometryBuffer(const GeometryBuffer&) = delete;
+		GeometryBuffer& operator=(const GeometryBuffer&) = delete;
+
+		// Stages a mesh and returns its index. Throws if an index is out of its
+		// vertices. The mesh cannot be drawn before the next upload().
+		int addMesh(const MeshData& mesh);
+		int addMesh(const Vertex* vertices, int vertex_count, const GLuint* indices, int index_count);
+		void upload();
+		void destroy();
+
+		// Declares the position scale, before the program is created.
+		void addTo(mgl::ShaderProgram& program) const;
+		// Sets the position scale of the created program, which keeps it.
+		void setUniforms(mgl::ShaderProgram& program) const;
+
+		GLuint getVao() const { return vao; }
+		VertexFormat getVertexFormat() const { return format; }
+		float getPositionScale() const { return vertexLayout(format).scale; }
+		std::size_t getMeshCount() const { return meshes.size(); }
+		const MeshRange& getMesh(int mesh) const { return meshes[mesh]; }
+		// Bytes used in the GPU buffers.
+		GLsizeiptr getVertexBytes() const { return vertex_size; }
+		GLsizeiptr getIndexBytes() const { return index_size; }
+};
@@ -12,9 +12,19 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
-#include "./mglApp.hpp"         // IWYU pragma: keep
-#include "./mglConventions.hpp" // IWYU pragma: keep
-#include "./mglError.hpp"       // IWYU pragma: keep
-#include "./mglShader.hpp"      // IWYU pragma: keep
+#include "./mglApp.hpp"          // IWYU pragma: keep
+#include "./mglBlock.hpp"        // IWYU pragma: keep
+#include "./mglCommandList.hpp"  // IWYU pragma: keep
+#include "./mglConventions.hpp"  // IWYU pragma: keep
+#include "./mglError.hpp"        // IWYU pragma: keep
+#include "./mglJobs.hpp"         // IWYU pragma: keep
+#include "./mglLayer.hpp"        // IWYU pragma: keep
+#include "./mglProfiler.hpp"     // IWYU pragma: keep
+#include "./mglRenderQueue.hpp"  // IWYU pragma: keep
+#include "./mglShader.hpp"       // IWYU pragma: keep
+#include "./mglSnapshot.hpp"     // IWYU pragma: keep
+#include "./mglState.hpp"        // IWYU pragma: keep
+#include "./mglStreamBuffer.hpp" // IWYU pragma: keep
+#include "./mglTiming.hpp"       // IWYU pragma: keep
 
 #endif /* MGL_HPP */
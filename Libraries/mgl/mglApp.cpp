@@ -9,21 +9,36 @@
 #include "./mglApp.hpp"
 
 #include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <iostream>
 #include <stdexcept>
 
 #include "./mglError.hpp" // IWYU pragma: keep -- required in debug mode
+#include "./mglState.hpp"
 
 namespace mgl {
 
 /////////////////////////////////////////////////////////////// STATIC CALLBACKS
 
+// With a render thread, both are called from it instead, see Engine::run()
+
 static void window_close_callback(GLFWwindow *window) {
-  Engine::getInstance().getApp()->windowCloseCallback(window);
+  if (!Engine::getInstance().hasRenderThread()) {
+    Engine::getInstance().getApp()->windowCloseCallback(window);
+  }
 }
 
 static void window_size_callback(GLFWwindow *window, int width, int height) {
-  Engine::getInstance().getApp()->windowSizeCallback(window, width, height);
+  if (!Engine::getInstance().hasRenderThread()) {
+    Engine::getInstance().getApp()->windowSizeCallback(window, width, height);
+  }
+  Engine::getInstance().requestRedraw();
+}
+
+static void window_refresh_callback(GLFWwindow *window) {
+  Engine::getInstance().requestRedraw();
 }
 
 static void glfw_error_callback(int error, const char *description) {
@@ -60,7 +75,15 @@ static void joystick_callback(int jid, int event) {
 Engine::Engine(void)
     : WindowWidth(640), WindowHeight(480), GlApp(nullptr), Window(nullptr),
       WindowTitle("OpenGL App GLFW Window 2025(c) Carlos Martinho"), GlMajor(3),
-      GlMinor(3), Fullscreen(0), Vsync(0) {}
+      GlMinor(3), Fullscreen(0), Vsync(0), OnDemand(false),
+      RedrawRequested(true), RedrawDeadline(-1.0), FrameCount(0),
+      IdleTime(0.0), UpdateStep(1.0 / 60.0), UpdateTime(0.0),
+      UpdateAlpha(0.0), UpdateCount(0), Headless(false), FrameLimit(0),
+      StopRequested(false), ReportRequested(false), Framebuffer(0),
+      ColorBuffer(0), DepthBuffer(0), JobWorkers(0), RenderThread(false),
+      FramesPublished(0), FramesTaken(0), RenderStopping(false),
+      PublishedFrame(0), PublishedPoll(0.0), PublishedUpdate(0.0),
+      PublishedWidth(0), PublishedHeight(0) {}
 
 Engine::~Engine(void) {}
 
@@ -89,15 +112,58 @@ void Engine::setWindow(int width, int height, const char *title, int fullscreen,
 
 /////////////////////////////////////////////////////////////////////////// INIT
 
+void Engine::setHeadless(bool headless) { Headless = headless; }
+
 void Engine::setupWindow() {
-  GLFWmonitor *monitor = Fullscreen ? glfwGetPrimaryMonitor() : nullptr;
+  GLFWmonitor *monitor =
+      Fullscreen && !Headless ? glfwGetPrimaryMonitor() : nullptr;
   Window = glfwCreateWindow(WindowWidth, WindowHeight, WindowTitle, monitor,
                             nullptr);
+  if (!Window && Headless) {
+    // Surfaceless EGL needs EGL_MESA_platform_surfaceless, OSMesa does not
+    glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+    Window = glfwCreateWindow(WindowWidth, WindowHeight, WindowTitle, nullptr,
+                              nullptr);
+  }
   if (!Window) {
     throw std::runtime_error("Failed to create GLFW window.");
   }
   glfwMakeContextCurrent(Window);
-  glfwSwapInterval(Vsync);
+  if (!Headless) {
+    glfwSwapInterval(Vsync);
+  }
+}
+
+void Engine::setupFramebuffer() {
+  // Surfaceless contexts have no default framebuffer to draw to
+  glCreateRenderbuffers(1, &ColorBuffer);
+  glNamedRenderbufferStorage(ColorBuffer, GL_RGBA8, WindowWidth, WindowHeight);
+  glCreateRenderbuffers(1, &DepthBuffer);
+  glNamedRenderbufferStorage(DepthBuffer, GL_DEPTH24_STENCIL8, WindowWidth,
+                             WindowHeight);
+  glCreateFramebuffers(1, &Framebuffer);
+  glNamedFramebufferRenderbuffer(Framebuffer, GL_COLOR_ATTACHMENT0,
+                                 GL_RENDERBUFFER, ColorBuffer);
+  glNamedFramebufferRenderbuffer(Framebuffer, GL_DEPTH_STENCIL_ATTACHMENT,
+                                 GL_RENDERBUFFER, DepthBuffer);
+  const GLenum status =
+      glCheckNamedFramebufferStatus(Framebuffer, GL_FRAMEBUFFER);
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    std::cerr << "[ERROR] Headless framebuffer incomplete (0x" << std::hex
+              << status << std::dec << ")" << std::endl;
+    throw std::runtime_error("Failed to create headless framebuffer.");
+  }
+  StateCache::getInstance().bindFramebuffer(Framebuffer);
+}
+
+void Engine::destroyFramebuffer() {
+  if (Framebuffer != 0) {
+    StateCache::getInstance().forgetFramebuffer(Framebuffer);
+    glDeleteFramebuffers(1, &Framebuffer);
+    glDeleteRenderbuffers(1, &ColorBuffer);
+    glDeleteRenderbuffers(1, &DepthBuffer);
+    Framebuffer = ColorBuffer = DepthBuffer = 0;
+  }
 }
 
 void Engine::setupCallbacks() {
@@ -108,10 +174,15 @@ void Engine::setupCallbacks() {
   glfwSetJoystickCallback(joystick_callback);
   glfwSetWindowCloseCallback(Window, window_close_callback);
   glfwSetWindowSizeCallback(Window, window_size_callback);
+  glfwSetWindowRefreshCallback(Window, window_refresh_callback);
 }
 
 void Engine::setupGLFW() {
   glfwSetErrorCallback(glfw_error_callback);
+  if (Headless) {
+    // Windows of the null platform need no display and are never shown
+    glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+  }
   if (!glfwInit()) {
     throw std::runtime_error("Failed to initialize GLFW.");
   }
@@ -120,6 +191,10 @@ void Engine::setupGLFW() {
 #ifdef DEBUG
   glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
 #endif
+  if (Headless) {
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+  }
   setupWindow();
   setupCallbacks();
 }
@@ -138,13 +213,14 @@ void Engine::setupGLEW() {
 }
 
 void Engine::setupOpenGL() {
+  StateCache &state = StateCache::getInstance();
   glClearColor(0.1f, 0.1f, 0.3f, 1.0f);
-  glEnable(GL_DEPTH_TEST);
+  state.enable(GL_DEPTH_TEST);
   glDepthFunc(GL_LEQUAL);
   glDepthMask(GL_TRUE);
   glDepthRange(0.0, 1.0);
   glClearDepth(1.0);
-  glEnable(GL_CULL_FACE);
+  state.enable(GL_CULL_FACE);
   glCullFace(GL_BACK);
   glFrontFace(GL_CCW);
   glViewport(0, 0, WindowWidth, WindowHeight);
@@ -162,9 +238,14 @@ void displayInfo() {
 }
 
 void Engine::init() {
+  MainThread = std::this_thread::get_id();
   setupGLFW();
   setupGLEW();
+  if (Headless) {
+    setupFramebuffer();
+  }
   setupOpenGL();
+  Jobs = std::make_unique<JobSystem>(JobWorkers);
   GlApp->initCallback(Window);
 #ifdef DEBUG
   displayInfo();
@@ -174,23 +255,312 @@ void Engine::init() {
 
 //////////////////////////////////////////////////////////////////////////// RUN
 
-void Engine::run() {
+void Engine::setOnDemand(bool on_demand) { OnDemand = on_demand; }
+
+void Engine::requestRedraw() {
+  // Wakes up the main thread, which may be waiting for events
+  if (!RedrawRequested.exchange(true) && Window &&
+      std::this_thread::get_id() != MainThread) {
+    glfwPostEmptyEvent();
+  }
+}
+
+void Engine::requestRedrawIn(double seconds) {
+  const double deadline = glfwGetTime() + seconds;
+  if (RedrawDeadline < 0.0 || deadline < RedrawDeadline) {
+    RedrawDeadline = deadline;
+  }
+}
+
+void Engine::setUpdateRate(double steps_per_second) {
+  if (steps_per_second <= 0.0) {
+    std::cerr << "[ERROR] Update rate must be positive." << std::endl;
+    throw std::invalid_argument("Update rate must be positive.");
+  }
+  UpdateStep = 1.0 / steps_per_second;
+}
+
+void Engine::setJobWorkers(std::size_t workers) { JobWorkers = workers; }
+
+JobSystem &Engine::getJobs() {
+  if (!Jobs) {
+    std::cerr << "[ERROR] No job system before Engine::init()." << std::endl;
+    throw std::runtime_error("No job system before Engine::init().");
+  }
+  return *Jobs;
+}
+
+void Engine::setRenderThread(bool render_thread) {
+  RenderThread = render_thread;
+}
+
+void Engine::setFrameLimit(unsigned long frames) { FrameLimit = frames; }
+
+void Engine::stop() {
+  if (!StopRequested.exchange(true) && Window &&
+      std::this_thread::get_id() != MainThread) {
+    glfwPostEmptyEvent();
+  }
+}
+
+bool Engine::isDone() const {
+  return StopRequested || (FrameLimit > 0 && FrameCount >= FrameLimit);
+}
+
+void Engine::readPixels(std::vector<GLubyte> &rgba, int &width, int &height) {
+  StateCache &state = StateCache::getInstance();
+  glfwGetFramebufferSize(Window, &width, &height);
+  rgba.resize(static_cast<std::size_t>(width) * height * 4);
+  const GLuint previous = state.getFramebuffer();
+  state.bindFramebuffer(Framebuffer);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+  state.bindFramebuffer(previous);
+}
+
+void Engine::reportTiming(std::ostream &out) const {
+  Timing.report(out);
+  GpuTiming.report(out);
+}
+
+void Engine::requestTimingReport() {
+  ReportRequested = true;
+  requestRedraw();
+}
+
+void Engine::addFrameTiming(unsigned long frame,
+                            const double (&phases)[FrameTimer::PHASES]) {
+  Timing.addFrame(frame, phases);
+  // The timings are only written by the thread that draws
+  if (ReportRequested.exchange(false)) {
+    reportTiming(std::cout);
+  }
+}
+
+bool Engine::waitForRedraw() {
+  if (!RedrawRequested) {
+    const double start = glfwGetTime();
+    if (RedrawDeadline < 0.0) {
+      glfwWaitEvents();
+    } else if (RedrawDeadline > start) {
+      glfwWaitEventsTimeout(RedrawDeadline - start);
+    }
+    const double now = glfwGetTime();
+    IdleTime += now - start;
+    if (RedrawDeadline >= 0.0 && now >= RedrawDeadline) {
+      RedrawDeadline = -1.0;
+      RedrawRequested = true;
+    }
+  }
+  return RedrawRequested;
+}
+
+void Engine::update(double elapsed) {
+  UpdateTime += std::max(elapsed, 0.0);
+  int steps = 0;
+  while (UpdateTime >= UpdateStep && steps < MAX_UPDATES) {
+    GlApp->updateCallback(Window, UpdateStep);
+    UpdateTime -= UpdateStep;
+    UpdateCount++;
+    steps++;
+  }
+  if (steps == MAX_UPDATES) {
+    // Too far behind, e.g. after a breakpoint: the App slows down rather than
+    // spending every frame catching up
+    UpdateTime = std::fmod(UpdateTime, UpdateStep);
+  }
+  UpdateAlpha = UpdateTime / UpdateStep;
+}
+
+void Engine::drawFrame(double elapsed, double &display_time,
+                       double &swap_time) {
+  const auto start = std::chrono::steady_clock::now();
+  GpuTiming.beginFrame();
+  {
+    GpuScope frame_scope(GpuTiming, "frame");
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+    GlApp->displayCallback(Window, elapsed);
+  }
+  GpuTiming.endFrame();
+  StateCache::getInstance().endFrame();
+  const auto displayed = std::chrono::steady_clock::now();
+  if (Headless) {
+    glFlush();
+  } else {
+    glfwSwapBuffers(Window);
+  }
+  const auto swapped = std::chrono::steady_clock::now();
+  display_time = std::chrono::duration<double>(displayed - start).count();
+  swap_time = std::chrono::duration<double>(swapped - displayed).count();
+}
+
+void Engine::runSerial() {
   double last_time = glfwGetTime();
-  while (!glfwWindowShouldClose(Window)) {
+  double last_idle = IdleTime;
+  while (!glfwWindowShouldClose(Window) && !isDone()) {
     try {
+      if (OnDemand && !Headless && !waitForRedraw()) {
+        continue;
+      }
+      // Cleared before drawing, so that the frame can request the next one
+      RedrawRequested = false;
+      FrameCount++;
       double time = glfwGetTime();
       double elapsed_time = time - last_time;
       last_time = time;
-      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT |
-              GL_STENCIL_BUFFER_BIT);
-      GlApp->displayCallback(Window, elapsed_time);
-      glfwSwapBuffers(Window);
+      const auto start = std::chrono::steady_clock::now();
+      update(Headless ? UpdateStep : elapsed_time - (IdleTime - last_idle));
+      last_idle = IdleTime;
+      GlApp->snapshotCallback(Window);
+      const auto updated = std::chrono::steady_clock::now();
+      double phases[FrameTimer::PHASES];
+      phases[FrameTimer::UPDATE] =
+          std::chrono::duration<double>(updated - start).count();
+      drawFrame(elapsed_time, phases[FrameTimer::DISPLAY],
+                phases[FrameTimer::SWAP]);
+      const auto swapped = std::chrono::steady_clock::now();
       glfwPollEvents();
+      phases[FrameTimer::POLL] = std::chrono::duration<double>(
+                                     std::chrono::steady_clock::now() - swapped)
+                                     .count();
+      addFrameTiming(FrameCount, phases);
     } catch (const std::exception &e) {
       std::cerr << "FRAME EXCEPTION: " << e.what() << std::endl;
       glfwSetWindowShouldClose(Window, GLFW_TRUE);
     }
   }
+}
+
+void Engine::runThreaded() {
+  // The render thread owns the context until it is done
+  glfwMakeContextCurrent(nullptr);
+  glfwGetWindowSize(Window, &PublishedWidth, &PublishedHeight);
+  FramesPublished = FramesTaken = 0;
+  RenderStopping = false;
+  std::thread render_thread(&Engine::renderLoop, this);
+
+  double last_time = glfwGetTime();
+  double last_idle = IdleTime;
+  double poll_time = 0.0;
+  while (!glfwWindowShouldClose(Window) && !isDone()) {
+    try {
+      if (OnDemand && !Headless && !waitForRedraw()) {
+        continue;
+      }
+      {
+        // At most one frame ahead: this one is simulated while the render
+        // thread draws the previous one
+        std::unique_lock<std::mutex> lock(FrameMutex);
+        FrameTaken.wait(lock,
+                        [this] { return FramesTaken == FramesPublished; });
+      }
+      RedrawRequested = false;
+      FrameCount++;
+      double time = glfwGetTime();
+      double elapsed_time = time - last_time;
+      last_time = time;
+      const auto start = std::chrono::steady_clock::now();
+      update(Headless ? UpdateStep : elapsed_time - (IdleTime - last_idle));
+      last_idle = IdleTime;
+      GlApp->snapshotCallback(Window);
+      const auto updated = std::chrono::steady_clock::now();
+      int width, height;
+      glfwGetWindowSize(Window, &width, &height);
+      {
+        std::lock_guard<std::mutex> lock(FrameMutex);
+        FramesPublished++;
+        PublishedFrame = FrameCount;
+        PublishedPoll = poll_time;
+        PublishedUpdate =
+            std::chrono::duration<double>(updated - start).count();
+        PublishedWidth = width;
+        PublishedHeight = height;
+      }
+      FrameReady.notify_one();
+      glfwPollEvents();
+      poll_time = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - updated)
+                      .count();
+    } catch (const std::exception &e) {
+      std::cerr << "FRAME EXCEPTION: " << e.what() << std::endl;
+      glfwSetWindowShouldClose(Window, GLFW_TRUE);
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(FrameMutex);
+    RenderStopping = true;
+  }
+  FrameReady.notify_one();
+  render_thread.join();
+  glfwMakeContextCurrent(Window);
+}
+
+void Engine::renderLoop() {
+  glfwMakeContextCurrent(Window);
+  int width, height;
+  glfwGetWindowSize(Window, &width, &height);
+  double last_time = glfwGetTime();
+  while (true) {
+    unsigned long frame;
+    double phases[FrameTimer::PHASES];
+    int new_width, new_height;
+    {
+      std::unique_lock<std::mutex> lock(FrameMutex);
+      FrameReady.wait(lock, [this] {
+        return FramesTaken < FramesPublished || RenderStopping;
+      });
+      // Frames published before stopping are still drawn
+      if (FramesTaken == FramesPublished) {
+        break;
+      }
+      FramesTaken = FramesPublished;
+      frame = PublishedFrame;
+      phases[FrameTimer::POLL] = PublishedPoll;
+      phases[FrameTimer::UPDATE] = PublishedUpdate;
+      new_width = PublishedWidth;
+      new_height = PublishedHeight;
+    }
+    FrameTaken.notify_one();
+    try {
+      if (new_width != width || new_height != height) {
+        width = new_width;
+        height = new_height;
+        GlApp->windowSizeCallback(Window, width, height);
+      }
+      double time = glfwGetTime();
+      double elapsed_time = time - last_time;
+      last_time = time;
+      drawFrame(elapsed_time, phases[FrameTimer::DISPLAY],
+                phases[FrameTimer::SWAP]);
+      addFrameTiming(frame, phases);
+    } catch (const std::exception &e) {
+      std::cerr << "FRAME EXCEPTION: " << e.what() << std::endl;
+      glfwSetWindowShouldClose(Window, GLFW_TRUE);
+      glfwPostEmptyEvent();
+    }
+  }
+  glfwMakeContextCurrent(nullptr);
+}
+
+void Engine::run() {
+  if (RenderThread) {
+    runThreaded();
+  } else {
+    runSerial();
+  }
+  if (Timing.getTotal().getCount() > 0) {
+    reportTiming(std::cout);
+  }
+  // With a render thread, GLFW closing the window did not call it, as the
+  // context was not current on the main thread
+  if (RenderThread || (isDone() && !glfwWindowShouldClose(Window))) {
+    // As if the window had been closed
+    GlApp->windowCloseCallback(Window);
+  }
+  Jobs.reset();
+  GpuTiming.destroy();
+  destroyFramebuffer();
   glfwDestroyWindow(Window);
   Window = nullptr;
   glfwTerminate();
@@ -14,6 +14,17 @@
 #include <glm/ext.hpp>
 #include <glm/glm.hpp>
 
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "./mglJobs.hpp"
+#include "./mglProfiler.hpp"
+#include "./mglTiming.hpp"
+
 namespace mgl {
 
 class App;
@@ -24,6 +35,8 @@ class Engine;
 class App {
 public:
   virtual void initCallback(GLFWwindow *window) {}
+  virtual void updateCallback(GLFWwindow *window, double step) {}
+  virtual void snapshotCallback(GLFWwindow *window) {}
   virtual void displayCallback(GLFWwindow *window, double elapsed) {}
   virtual void windowCloseCallback(GLFWwindow *window) {}
   virtual void windowSizeCallback(GLFWwindow *window, int width, int height) {}
@@ -42,10 +55,60 @@ protected:
 
 ///////////////////////////////////////////////////////////////////////// Engine
 
+// By default run() draws frames continuously. On demand, it only draws a frame
+// after requestRedraw() (e.g. from an input callback, or from displayCallback
+// while an animation runs), once a delay given to requestRedrawIn() is over
+// (e.g. a timer), or when the window is resized or must be refreshed. In
+// between it sleeps in glfwWaitEvents, so an idle window costs no CPU or GPU
+// time, and any input wakes it up at once. The elapsed time given to
+// displayCallback is then the time since the previous frame, however long.
+//
+// Headless, no display is needed: the window is made by the GLFW null platform
+// and never shown, with a surfaceless EGL context or, failing that, an OSMesa
+// one (e.g. Mesa llvmpipe). Frames are drawn into a framebuffer object of the
+// window size, bound as the default framebuffer through the StateCache, and
+// readPixels() reads them back. Headless runs draw every frame, on demand or
+// not, as nothing would wake them up. Either way, run() returns after the
+// frame limit or once stop() is called, and then calls windowCloseCallback
+// while the context is still current.
+//
+// The state of the App advances in updateCallback by steps of a fixed duration,
+// apart from how often frames are drawn: before each frame, as many steps run
+// as fit in the time since the previous one, at most MAX_UPDATES, and the time
+// left over carries to the next frame. displayCallback then draws between the
+// state before the last step and the state after it, getUpdateAlpha() of the
+// way. Time spent idle on demand is not simulated, as nothing asked for a
+// frame, and headless frames advance exactly one step each, so that their
+// results do not depend on how fast they are drawn. Steps only run when a
+// frame is drawn: on demand, an App whose state is moving requests a redraw.
+//
+// With a render thread, input and updates stay on the main thread and the
+// render thread owns the context: it calls displayCallback, swaps buffers and
+// calls windowSizeCallback when the size changed, while the main thread
+// already runs the updates of the next frame, at most one frame ahead. Apart
+// from initCallback and windowCloseCallback, which run on the main thread
+// before and after, the callbacks on the main thread must not use OpenGL nor
+// the state displayCallback reads. After the updates of each frame, in either
+// mode, snapshotCallback copies that state, e.g. into a TripleBuffer, for the
+// next displayCallback to draw.
+//
+// The Engine owns the JobSystem the App spreads its work over, e.g. the
+// transformations or the culling of a frame, from init() until run() returns.
+// With a render thread, both threads may use it at once.
+//
+// The time every frame spends polling events, in updateCallback, in
+// displayCallback and swapping buffers goes to the FrameTimer. The GPU time of
+// the frame goes to the GpuProfiler as the "frame" pass, along with the passes
+// the App times inside it. run() reports both before returning. With a render
+// thread, the phases of a frame overlap those of the next, so that frames are
+// drawn more often than their total time suggests.
+
 class Engine {
 public:
   int WindowWidth, WindowHeight;
 
+  static const int MAX_UPDATES = 8; // Steps per frame, the rest is dropped
+
   static Engine &getInstance();
 
   void setApp(App *app);
@@ -56,6 +119,52 @@ public:
   void init();
   void run();
 
+  void setOnDemand(bool on_demand);
+  // May be called from any thread.
+  void requestRedraw();
+  void requestRedrawIn(double seconds);
+  unsigned long getFrameCount() const { return FrameCount; }
+  // Time spent waiting for a redraw in on demand mode, in seconds.
+  double getIdleTime() const { return IdleTime; }
+
+  // Steps of updateCallback per second, 60 by default.
+  void setUpdateRate(double steps_per_second);
+  double getUpdateStep() const { return UpdateStep; }
+  // Fraction of a step left over when the frame is drawn, from 0 to 1.
+  double getUpdateAlpha() const { return UpdateAlpha; }
+  unsigned long getUpdateCount() const { return UpdateCount; }
+
+  // Must be set before init(), 0 for one per hardware thread but the main one.
+  void setJobWorkers(std::size_t workers);
+  JobSystem &getJobs();
+
+  // Must be set before run().
+  void setRenderThread(bool render_thread);
+  bool hasRenderThread() const { return RenderThread; }
+
+  // Must be set before init(). Requires OpenGL 4.5.
+  void setHeadless(bool headless);
+  bool isHeadless() const { return Headless; }
+  // Number of frames after which run() returns, 0 for no limit.
+  void setFrameLimit(unsigned long frames);
+  // May be called from any thread.
+  void stop();
+  // Framebuffer frames are drawn to, 0 unless headless.
+  GLuint getFramebuffer() const { return Framebuffer; }
+  FrameTimer &getFrameTimer() { return Timing; }
+  const FrameTimer &getFrameTimer() const { return Timing; }
+  GpuProfiler &getGpuProfiler() { return GpuTiming; }
+  // CPU timings of the frame phases, then GPU timings of the passes. Only
+  // from the thread that draws, or once run() returned.
+  void reportTiming(std::ostream &out) const;
+  // Reports the timings to std::cout once the next frame is drawn, by the
+  // thread that draws it. May be called from any thread, e.g. input callbacks.
+  void requestTimingReport();
+
+  // RGBA rows of the frame, bottom to top. Windowed, the frame must not have
+  // been swapped yet, e.g. at the end of displayCallback.
+  void readPixels(std::vector<GLubyte> &rgba, int &width, int &height);
+
 protected:
   virtual ~Engine();
 
@@ -67,8 +176,46 @@ private:
   int GlMajor, GlMinor;
   int Fullscreen;
   int Vsync;
-
+  bool OnDemand;
+  std::thread::id MainThread;
+  std::atomic<bool> RedrawRequested;
+  double RedrawDeadline; // Negative if none
+  unsigned long FrameCount;
+  double IdleTime;
+  double UpdateStep;
+  double UpdateTime; // Not yet simulated, less than a step between frames
+  double UpdateAlpha;
+  unsigned long UpdateCount;
+  bool Headless;
+  unsigned long FrameLimit;
+  std::atomic<bool> StopRequested;
+  std::atomic<bool> ReportRequested;
+  GLuint Framebuffer, ColorBuffer, DepthBuffer;
+  FrameTimer Timing;
+  GpuProfiler GpuTiming;
+  std::size_t JobWorkers;
+  std::unique_ptr<JobSystem> Jobs;
+  bool RenderThread;
+  std::mutex FrameMutex; // Guards the frame handed to the render thread
+  std::condition_variable FrameReady, FrameTaken;
+  unsigned long FramesPublished, FramesTaken;
+  bool RenderStopping;
+  unsigned long PublishedFrame;
+  double PublishedPoll, PublishedUpdate;
+  int PublishedWidth, PublishedHeight;
+
+  bool waitForRedraw();
+  void update(double elapsed);
+  void drawFrame(double elapsed, double &display_time, double &swap_time);
+  void addFrameTiming(unsigned long frame,
+                      const double (&phases)[FrameTimer::PHASES]);
+  void runSerial();
+  void runThreaded();
+  void renderLoop();
+  bool isDone() const;
   void setupWindow();
+  void setupFramebuffer();
+  void destroyFramebuffer();
   void setupGLFW();
   void setupGLEW();
   void setupOpenGL();
@@ -0,0 +1,59 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Uniform and Shader Storage Blocks
+//
+// Copyright (c)2022-25 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "./mglBlock.hpp"
+#include "./mglState.hpp"
+
+#include <iostream>
+#include <stdexcept>
+
+namespace mgl {
+
+//////////////////////////////////////////////////////////////////// BufferBlock
+
+BufferBlock::BufferBlock(const GLenum target, const GLuint binding_point)
+    : BufferId(0), Target(target), BindingPoint(binding_point), Capacity(0) {
+  glGenBuffers(1, &BufferId);
+}
+
+BufferBlock::~BufferBlock() {
+  StateCache::getInstance().forgetBuffer(BufferId);
+  glDeleteBuffers(1, &BufferId);
+}
+
+void BufferBlock::bind() {
+  StateCache::getInstance().bindBufferBase(Target, BindingPoint, BufferId);
+}
+
+void BufferBlock::bindRange(const GLuint buffer, const GLintptr offset,
+                            const GLsizeiptr size) {
+  StateCache::getInstance().bindBufferRange(Target, BindingPoint, buffer,
+                                            offset, size);
+}
+
+void BufferBlock::upload(const void *data, const GLsizeiptr size) {
+  StateCache::getInstance().bindBuffer(Target, BufferId);
+  if (size > Capacity) {
+    glBufferData(Target, size, data, GL_DYNAMIC_DRAW);
+    Capacity = size;
+  } else {
+    glBufferSubData(Target, 0, size, data);
+  }
+}
+
+void BufferBlock::checkSize(const std::string &name, const GLint program_size,
+                            const std::size_t cpp_size) {
+  if (program_size != static_cast<GLint>(cpp_size)) {
+    std::cerr << "[ERROR] Block " << name << " has size " << program_size
+              << " in the program and " << cpp_size << " in C++" << std::endl;
+    throw std::runtime_error("Block layout mismatch.");
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
@@ -0,0 +1,146 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Uniform and Shader Storage Blocks
+//
+// Copyright (c)2022-25 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MGL_BLOCK_HPP
+#define MGL_BLOCK_HPP
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <string>
+#include <type_traits>
+
+#include "./mglShader.hpp"
+
+namespace mgl {
+
+class BufferBlock;
+template <typename T> class UniformBlock;
+template <typename T> class StorageBlock;
+
+////////////////////////////////////////////////////////////////// Block Layouts
+
+// C++ structs mirroring a GLSL block must declare their members at the GLSL
+// offsets, padding included (e.g. a vec3 takes 16 bytes in std140). What can
+// be checked at compile time is checked by the block classes below; member
+// offsets can be checked with MGL_BLOCK_OFFSET. Sizes are checked against the
+// linked program by check().
+
+// A std140 block is padded to a multiple of the size of a vec4.
+template <typename T> constexpr bool isStd140Block() {
+  return std::is_trivially_copyable<T>::value && sizeof(T) % 16 == 0;
+}
+
+// A std430 array element is made of 4-byte scalars.
+template <typename T> constexpr bool isStd430Element() {
+  return std::is_trivially_copyable<T>::value && sizeof(T) % 4 == 0;
+}
+
+#define MGL_BLOCK_OFFSET(type, member, offset)                                 \
+  static_assert(offsetof(type, member) == (offset),                           \
+                #type "::" #member " is not at its block offset")
+
+//////////////////////////////////////////////////////////////////// BufferBlock
+
+// Buffer bound to the binding point of a uniform block (GL_UNIFORM_BUFFER) or
+// of a shader storage block (GL_SHADER_STORAGE_BUFFER). The block either owns
+// its buffer, written by upload(), or is bound to a range of another buffer.
+
+class BufferBlock {
+public:
+  GLuint BufferId;
+  GLenum Target;
+  GLuint BindingPoint;
+
+  BufferBlock(const GLenum target, const GLuint binding_point);
+  ~BufferBlock();
+
+  BufferBlock(const BufferBlock &) = delete;
+  BufferBlock &operator=(const BufferBlock &) = delete;
+
+  // Binds the whole owned buffer to the binding point.
+  void bind();
+  // Binds a range of any buffer to the binding point.
+  void bindRange(const GLuint buffer, const GLintptr offset,
+                 const GLsizeiptr size);
+
+protected:
+  GLsizeiptr Capacity;
+
+  // Writes the owned buffer with a single call, growing it if needed.
+  void upload(const void *data, const GLsizeiptr size);
+  static void checkSize(const std::string &name, const GLint program_size,
+                        const std::size_t cpp_size);
+};
+
+//////////////////////////////////////////////////////////////// UniformBlock<T>
+
+// std140 uniform block holding a single T, bound to the binding point given to
+// ShaderProgram::addUniformBlock.
+
+template <typename T> class UniformBlock final : public BufferBlock {
+  static_assert(isStd140Block<T>(),
+                "std140 blocks must be padded to a multiple of 16 bytes");
+
+public:
+  explicit UniformBlock(const GLuint binding_point)
+      : BufferBlock(GL_UNIFORM_BUFFER, binding_point) {}
+
+  // Writes the block with a single call and binds it.
+  void set(const T &value) {
+    upload(&value, sizeof(T));
+    bind();
+  }
+
+  // Throws if the block of a linked program does not have the size of T.
+  void check(ShaderProgram &program, const std::string &name) const {
+    checkSize(name, program.isUniformBlock(name) ? program.Ubos[name].size : -1,
+              sizeof(T));
+  }
+};
+
+//////////////////////////////////////////////////////////////// StorageBlock<T>
+
+// std430 shader storage block made of a runtime-sized array of T,
+//   layout(std430) buffer Name { T Array[]; };
+// bound to the binding point given to ShaderProgram::addStorageBlock. Shaders
+// index the array with e.g. gl_DrawID or gl_BaseInstance + gl_InstanceID.
+
+template <typename T> class StorageBlock final : public BufferBlock {
+  static_assert(isStd430Element<T>(),
+                "std430 array elements must be made of 4-byte scalars");
+
+public:
+  explicit StorageBlock(const GLuint binding_point)
+      : BufferBlock(GL_SHADER_STORAGE_BUFFER, binding_point) {}
+
+  // Writes count elements to the owned buffer and binds it.
+  void set(const T *values, const std::size_t count) {
+    upload(values, count * sizeof(T));
+    bind();
+  }
+
+  // Binds count elements of another buffer, e.g. a StreamBuffer region.
+  void bind(const GLuint buffer, const GLintptr offset,
+            const std::size_t count) {
+    bindRange(buffer, offset, count * sizeof(T));
+  }
+  using BufferBlock::bind;
+
+  // Throws if the array stride of a linked program is not the size of T.
+  void check(ShaderProgram &program, const std::string &name) const {
+    checkSize(name,
+              program.isStorageBlock(name) ? program.Ssbos[name].stride : -1,
+              sizeof(T));
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
+
+#endif /* MGL_BLOCK_HPP */
@@ -0,0 +1,49 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Multithreaded Draw Command Recording
+//
+// Copyright (c)2022-25 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "./mglCommandList.hpp"
+
+#include <algorithm>
+
+namespace mgl {
+
+//////////////////////////////////////////////////////////////// CommandRecorder
+
+CommandRecorder::CommandRecorder(JobSystem &jobs)
+    : Jobs(jobs), Lists(jobs.getThreadCount()), Ranges(0) {}
+
+void CommandRecorder::record(const std::size_t count, const RecordTask &task,
+                             const std::size_t grain) {
+  if (count == 0) {
+    Ranges = 0;
+    return;
+  }
+  const std::size_t ranges = std::min(
+      Lists.size(), (count + std::max<std::size_t>(grain, 1) - 1) /
+                        std::max<std::size_t>(grain, 1));
+  Ranges = ranges;
+  if (ranges == 1) {
+    task(0, count, Lists[0]);
+    return;
+  }
+  Jobs.parallelInvoke(ranges, [&](std::size_t range) {
+    task(count * range / ranges, count * (range + 1) / ranges, Lists[range]);
+  });
+}
+
+void CommandRecorder::submit(RenderQueue &queue) {
+  for (CommandList &list : Lists) {
+    for (const CommandList::Command &command : list.getCommands()) {
+      queue.submit(command.Layer, command.Item, command.Order);
+    }
+    list.clear();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
@@ -0,0 +1,89 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Multithreaded Draw Command Recording
+//
+// Copyright (c)2022-25 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MGL_COMMAND_LIST_HPP
+#define MGL_COMMAND_LIST_HPP
+
+#include "./mglJobs.hpp"
+#include "./mglRenderQueue.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace mgl {
+
+class CommandList;
+class CommandRecorder;
+
+//////////////////////////////////////////////////////////////////// CommandList
+
+// Linear buffer of draw items recorded by one thread. Recording makes no GL
+// call, the items are only issued once submitted to a RenderQueue. Memory is
+// kept across frames, so steady-state recording does not allocate.
+
+class CommandList final {
+public:
+  struct Command {
+    DrawItem Item;
+    std::uint32_t Order;
+    std::uint8_t Layer;
+  };
+
+  void record(const std::uint8_t layer, const DrawItem &item,
+              const std::uint32_t order = 0) {
+    Commands.push_back({item, order, layer});
+  }
+  void clear() { Commands.clear(); }
+
+  std::size_t size() const { return Commands.size(); }
+  const std::vector<Command> &getCommands() const { return Commands; }
+
+private:
+  std::vector<Command> Commands;
+};
+
+//////////////////////////////////////////////////////////////// CommandRecorder
+
+// Splits a range of work, e.g. pieces, into at most one contiguous range per
+// thread of a JobSystem, each recording into its own CommandList. The calling
+// thread waits for the ranges, so GL calls stay on it: tasks may write to
+// mapped buffers but must not call GL. submit() then hands the lists to a
+// RenderQueue in range order, so the result does not depend on scheduling.
+// Ranges smaller than the grain are not split and run on the calling thread.
+
+class CommandRecorder final {
+public:
+  typedef std::function<void(std::size_t begin, std::size_t end,
+                             CommandList &list)>
+      RecordTask;
+  static const std::size_t DEFAULT_GRAIN = 4096;
+
+  explicit CommandRecorder(JobSystem &jobs);
+  CommandRecorder(const CommandRecorder &) = delete;
+  CommandRecorder &operator=(const CommandRecorder &) = delete;
+
+  void record(const std::size_t count, const RecordTask &task,
+              const std::size_t grain = DEFAULT_GRAIN);
+  // Submits and clears the lists recorded since the last submit().
+  void submit(RenderQueue &queue);
+
+  std::size_t getWorkerCount() const { return Lists.size(); }
+  // Number of ranges the last record() was split into.
+  std::size_t getLastRangeCount() const { return Ranges; }
+
+private:
+  JobSystem &Jobs;
+  std::vector<CommandList> Lists; // Indexed by range
+  std::size_t Ranges;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
+
+#endif /* MGL_COMMAND_LIST_HPP */
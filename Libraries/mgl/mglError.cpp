@@ -11,6 +11,7 @@
 #include <GL/glew.h>
 
 #include <iostream>
+#include <vector>
 
 ////////////////////////////////////////////////////// DEBUG OUTPUT (OPENGL 4.3)
 
@@ -73,6 +74,8 @@ const std::string errorSeverity(GLenum severity) {
   }
 }
 
+static std::vector<const char *> DebugGroups;
+
 void error(GLenum source, GLenum type, GLuint id, GLenum severity,
            GLsizei length, const GLchar *message, const void *userParam) {
 
@@ -85,6 +88,13 @@ void error(GLenum source, GLenum type, GLuint id, GLenum severity,
   std::cerr << "  source:     " << errorSource(source) << std::endl;
   std::cerr << "  type:       " << errorType(type) << std::endl;
   std::cerr << "  severity:   " << errorSeverity(severity) << std::endl;
+  if (!DebugGroups.empty()) {
+    std::cerr << "  group:      ";
+    for (std::size_t i = 0; i < DebugGroups.size(); i++) {
+      std::cerr << (i > 0 ? "/" : "") << DebugGroups[i];
+    }
+    std::cerr << std::endl;
+  }
   std::cerr << "  debug call: " << std::endl
             << message << std::endl
             << std::endl;
@@ -104,10 +114,33 @@ void setupDebugOutput() {
   glDebugMessageCallback(error, nullptr);
   glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr,
                         GL_TRUE);
+  // Groups are named in the messages raised inside them instead
+  glDebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_PUSH_GROUP, GL_DONT_CARE, 0,
+                        nullptr, GL_FALSE);
+  glDebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_POP_GROUP, GL_DONT_CARE, 0,
+                        nullptr, GL_FALSE);
   // glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE,
   //                       GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr,
   //                       GL_FALSE);
   // params: source, type, severity, count, ids, enabled
 }
 
+////////////////////////////////////////////////////// DEBUG GROUPS (OPENGL 4.3)
+
+void pushDebugGroup(const char *name) {
+  DebugGroups.push_back(name);
+  if (glPushDebugGroup) {
+    glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+  }
+}
+
+void popDebugGroup() {
+  if (!DebugGroups.empty()) {
+    DebugGroups.pop_back();
+    if (glPopDebugGroup) {
+      glPopDebugGroup();
+    }
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
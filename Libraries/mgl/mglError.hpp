@@ -13,5 +13,11 @@
 
 void setupDebugOutput();
 
+// Named regions of the command stream, shown by debuggers such as RenderDoc
+// and in the debug output messages raised inside them. Names must outlive the
+// region. Without OpenGL 4.3 or KHR_debug, only the messages show them.
+void pushDebugGroup(const char *name);
+void popDebugGroup();
+
 ////////////////////////////////////////////////////////////////////////////////
 #endif /* MGL_ERROR_HPP */
@@ -0,0 +1,388 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Work-Stealing Job System
+//
+// Copyright (c)2022-25 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "./mglJobs.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+
+namespace mgl {
+
+/////////////////////////////////////////////////////////////////// ScratchArena
+
+void *ScratchArena::allocate(const std::size_t bytes,
+                             const std::size_t alignment) {
+  for (;;) {
+    if (Block < Blocks.size()) {
+      const std::uintptr_t base =
+          reinterpret_cast<std::uintptr_t>(Blocks[Block].get());
+      const std::size_t offset =
+          ((base + Offset + alignment - 1) & ~(alignment - 1)) - base;
+      if (offset + bytes <= Sizes[Block]) {
+        Offset = offset + bytes;
+        return Blocks[Block].get() + offset;
+      }
+      if (Block + 1 < Blocks.size()) {
+        Block++;
+        Offset = 0;
+        continue;
+      }
+    }
+    // Large enough for the allocation whatever the alignment of the block
+    const std::size_t size =
+        bytes + alignment > BLOCK_SIZE ? bytes + alignment : BLOCK_SIZE;
+    Blocks.emplace_back(new unsigned char[size]);
+    Sizes.push_back(size);
+    Block = Blocks.size() - 1;
+    Offset = 0;
+  }
+}
+
+void ScratchArena::rewind(const Mark &mark) {
+  Block = mark.Block;
+  Offset = mark.Offset;
+}
+
+std::size_t ScratchArena::getCapacity() const {
+  std::size_t capacity = 0;
+  for (const std::size_t size : Sizes) {
+    capacity += size;
+  }
+  return capacity;
+}
+
+////////////////////////////////////////////////////////////////////// TaskGraph
+
+TaskGraph::TaskId TaskGraph::add(Task task) {
+  Nodes.emplace_back();
+  Nodes.back().Work = std::move(task);
+  return Nodes.size() - 1;
+}
+
+void TaskGraph::precede(const TaskId before, const TaskId after) {
+  if (before >= Nodes.size() || after >= Nodes.size()) {
+    std::cerr << "[ERROR] Invalid task " << std::max(before, after)
+              << " in task graph of " << Nodes.size() << std::endl;
+    throw std::runtime_error("Invalid task in task graph.");
+  }
+  Nodes[before].Successors.push_back(after);
+  Nodes[after].Predecessors++;
+}
+
+////////////////////////////////////////////////////////////////////// JobSystem
+
+// Times a worker with nothing to do yields before parking.
+static const int SPIN_YIELDS = 64;
+
+// Set on the worker threads, so that they queue jobs on their own queue.
+static thread_local const JobSystem *CurrentSystem = nullptr;
+static thread_local std::size_t CurrentWorker = 0;
+
+struct JobSystem::Counter {
+  std::atomic<std::size_t> Pending;
+  std::atomic<bool> Failed;
+  std::exception_ptr Error; // The first one thrown
+
+  explicit Counter(const std::size_t pending)
+      : Pending(pending), Failed(false) {}
+  void fail() {
+    if (!Failed.exchange(true)) {
+      Error = std::current_exception();
+    }
+  }
+  // Last access to the job, which its caller may then release
+  void done() { Pending.fetch_sub(1, std::memory_order_acq_rel); }
+};
+
+namespace {
+struct IndexState {
+  const JobSystem::IndexTask *Task;
+  std::size_t Count;
+  std::atomic<std::size_t> Next;
+};
+struct GraphState {
+  TaskGraph *Graph;
+  void *Jobs;
+};
+} // namespace
+
+JobSystem::JobSystem(std::size_t workers)
+    : Queued(0), Sleeping(0), Stopping(false), JobCount(0), StealCount(0) {
+  if (workers == 0) {
+    workers = std::max(1u, std::thread::hardware_concurrency()) - 1;
+  }
+  for (std::size_t queue = 0; queue <= workers; queue++) {
+    Queues.push_back(std::make_unique<Queue>());
+  }
+  for (std::size_t worker = 0; worker < workers; worker++) {
+    Threads.emplace_back(&JobSystem::workerLoop, this, worker);
+  }
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard<std::mutex> lock(ParkMutex);
+    Stopping = true;
+  }
+  Wake.notify_all();
+  for (std::thread &thread : Threads) {
+    thread.join();
+  }
+}
+
+ScratchArena &JobSystem::getScratch() {
+  static thread_local ScratchArena scratch;
+  return scratch;
+}
+
+std::size_t JobSystem::getQueueIndex() const {
+  return CurrentSystem == this ? CurrentWorker : Queues.size() - 1;
+}
+
+void JobSystem::push(Job *const *jobs, const std::size_t count) {
+  if (count == 0) {
+    return;
+  }
+  Queue &queue = *Queues[getQueueIndex()];
+  {
+    std::lock_guard<std::mutex> lock(queue.Mutex);
+    // Counted first, so that no job is ever queued but not counted
+    Queued += count;
+    queue.Jobs.insert(queue.Jobs.end(), jobs, jobs + count);
+  }
+  // A worker going to sleep counts itself then checks Queued, which was
+  // counted before Sleeping is read: either it sees the jobs, or it is woken
+  if (Sleeping > 0) {
+    std::lock_guard<std::mutex> lock(ParkMutex);
+    if (count > 1) {
+      Wake.notify_all();
+    } else {
+      Wake.notify_one();
+    }
+  }
+}
+
+JobSystem::Job *JobSystem::find(const std::size_t queue) {
+  if (Queued == 0) {
+    return nullptr;
+  }
+  // Newest first from its own queue, to use what is still in cache
+  {
+    Queue &own = *Queues[queue];
+    std::lock_guard<std::mutex> lock(own.Mutex);
+    if (!own.Jobs.empty()) {
+      Job *job = own.Jobs.back();
+      own.Jobs.pop_back();
+      Queued--;
+      return job;
+    }
+  }
+  // Oldest first from the others, the larger pieces of work
+  for (std::size_t i = 1; i < Queues.size(); i++) {
+    Queue &other = *Queues[(queue + i) % Queues.size()];
+    std::lock_guard<std::mutex> lock(other.Mutex);
+    if (!other.Jobs.empty()) {
+      Job *job = other.Jobs.front();
+      other.Jobs.pop_front();
+      Queued--;
+      // Jobs of the shared queue belong to no worker
+      if (&other != Queues.back().get()) {
+        StealCount.fetch_add(1, std::memory_order_relaxed);
+      }
+      return job;
+    }
+  }
+  return nullptr;
+}
+
+void JobSystem::execute(Job &job) {
+  ScratchArena &scratch = getScratch();
+  const ScratchArena::Mark mark = scratch.getMark();
+  JobCount.fetch_add(1, std::memory_order_relaxed);
+  job.Run(*this, job);
+  scratch.rewind(mark);
+}
+
+void JobSystem::wait(Counter &group, const std::size_t queue) {
+  while (group.Pending.load(std::memory_order_acquire) != 0) {
+    Job *job = find(queue);
+    if (job) {
+      execute(*job);
+    } else {
+      // The jobs left are running on other threads
+      std::this_thread::yield();
+    }
+  }
+}
+
+void JobSystem::workerLoop(const std::size_t worker) {
+  CurrentSystem = this;
+  CurrentWorker = worker;
+  for (;;) {
+    Job *job = find(worker);
+    if (job) {
+      execute(*job);
+      continue;
+    }
+    // The parallel loops of a frame come in quick succession, so a worker
+    // yields for a while before paying for parking and waking up
+    for (int i = 0; i < SPIN_YIELDS && Queued == 0 && !Stopping; i++) {
+      std::this_thread::yield();
+    }
+    if (Queued > 0) {
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(ParkMutex);
+    Sleeping++;
+    Wake.wait(lock, [this] { return Stopping || Queued > 0; });
+    Sleeping--;
+    if (Stopping && Queued == 0) {
+      return;
+    }
+  }
+}
+
+void JobSystem::runIndices(JobSystem &, Job &job) {
+  IndexState &state = *static_cast<IndexState *>(job.Data);
+  ScratchArena &scratch = getScratch();
+  const ScratchArena::Mark mark = scratch.getMark();
+  for (;;) {
+    const std::size_t index = state.Next.fetch_add(1);
+    if (index >= state.Count) {
+      break;
+    }
+    try {
+      (*state.Task)(index);
+    } catch (...) {
+      job.Group->fail();
+    }
+    scratch.rewind(mark);
+  }
+  job.Group->done();
+}
+
+void JobSystem::parallelInvoke(const std::size_t count, const IndexTask &task) {
+  if (count == 0) {
+    return;
+  }
+  // Each helper job takes indices until there are none left, so a job costs
+  // the same however many indices it runs
+  const std::size_t helpers = std::min(count - 1, Threads.size());
+  IndexState state = {&task, count, {0}};
+  Counter group(helpers + 1);
+  ScratchArena &scratch = getScratch();
+  const ScratchArena::Mark mark = scratch.getMark();
+  Job *jobs = scratch.allocate<Job>(helpers);
+  Job **queued = scratch.allocate<Job *>(helpers);
+  for (std::size_t i = 0; i < helpers; i++) {
+    jobs[i] = {&JobSystem::runIndices, &state, i, &group};
+    queued[i] = &jobs[i];
+  }
+  push(queued, helpers);
+  Job own = {&JobSystem::runIndices, &state, helpers, &group};
+  runIndices(*this, own);
+  wait(group, getQueueIndex());
+  scratch.rewind(mark);
+  if (group.Error) {
+    std::rethrow_exception(group.Error);
+  }
+}
+
+void JobSystem::parallelFor(const std::size_t count, const RangeTask &task,
+                            const std::size_t grain) {
+  const std::size_t min_size = std::max<std::size_t>(grain, 1);
+  const std::size_t ranges =
+      std::min((count + min_size - 1) / min_size, getThreadCount() * 4);
+  if (ranges <= 1) {
+    if (count > 0) {
+      task(0, count);
+    }
+    return;
+  }
+  parallelInvoke(ranges, [&](std::size_t range) {
+    task(count * range / ranges, count * (range + 1) / ranges);
+  });
+}
+
+void JobSystem::runNode(JobSystem &jobs, Job &job) {
+  GraphState &state = *static_cast<GraphState *>(job.Data);
+  Job *graph_jobs = static_cast<Job *>(state.Jobs);
+  TaskGraph::Node &node = state.Graph->Nodes[job.Index];
+  try {
+    node.Work();
+  } catch (...) {
+    job.Group->fail();
+  }
+  // Successors whose last predecessor this was are queued together
+  Job **ready = getScratch().allocate<Job *>(node.Successors.size());
+  std::size_t count = 0;
+  for (const TaskGraph::TaskId successor : node.Successors) {
+    if (state.Graph->Nodes[successor].Remaining.fetch_sub(1) == 1) {
+      ready[count++] = &graph_jobs[successor];
+    }
+  }
+  jobs.push(ready, count);
+  job.Group->done();
+}
+
+void JobSystem::run(TaskGraph &graph) {
+  const std::size_t count = graph.size();
+  if (count == 0) {
+    return;
+  }
+  ScratchArena &scratch = getScratch();
+  const ScratchArena::Mark mark = scratch.getMark();
+
+  // Tasks in a cycle would never start, and this would never return
+  std::size_t *remaining = scratch.allocate<std::size_t>(count);
+  TaskGraph::TaskId *order = scratch.allocate<TaskGraph::TaskId>(count);
+  std::size_t ordered = 0;
+  for (TaskGraph::TaskId id = 0; id < count; id++) {
+    remaining[id] = graph.Nodes[id].Predecessors;
+    if (remaining[id] == 0) {
+      order[ordered++] = id;
+    }
+  }
+  const std::size_t roots = ordered;
+  for (std::size_t i = 0; i < ordered; i++) {
+    for (const TaskGraph::TaskId successor : graph.Nodes[order[i]].Successors) {
+      if (--remaining[successor] == 0) {
+        order[ordered++] = successor;
+      }
+    }
+  }
+  if (ordered != count) {
+    scratch.rewind(mark);
+    std::cerr << "[ERROR] Task graph has a cycle through "
+              << count - ordered << " tasks" << std::endl;
+    throw std::runtime_error("Task graph has a cycle.");
+  }
+
+  Counter group(count);
+  Job *jobs = scratch.allocate<Job>(count);
+  GraphState state = {&graph, jobs};
+  Job **queued = scratch.allocate<Job *>(roots);
+  for (TaskGraph::TaskId id = 0; id < count; id++) {
+    graph.Nodes[id].Remaining = graph.Nodes[id].Predecessors;
+    jobs[id] = {&JobSystem::runNode, &state, id, &group};
+  }
+  for (std::size_t i = 0; i < roots; i++) {
+    queued[i] = &jobs[order[i]];
+  }
+  push(queued, roots);
+  wait(group, getQueueIndex());
+  scratch.rewind(mark);
+  if (group.Error) {
+    std::rethrow_exception(group.Error);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
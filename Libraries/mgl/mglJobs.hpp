@@ -0,0 +1,181 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Work-Stealing Job System
+//
+// Copyright (c)2022-25 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MGL_JOBS_HPP
+#define MGL_JOBS_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mgl {
+
+class ScratchArena;
+class TaskGraph;
+class JobSystem;
+
+/////////////////////////////////////////////////////////////////// ScratchArena
+
+// Bump allocator for the temporary memory of a task. Every thread running
+// tasks has its own, see JobSystem::getScratch(), and what a task allocates
+// is released when it returns. Blocks are kept, so steady-state allocation is
+// a pointer increment.
+
+class ScratchArena final {
+public:
+  struct Mark {
+    std::size_t Block, Offset;
+  };
+  static const std::size_t BLOCK_SIZE = 64 * 1024;
+
+  ScratchArena() : Block(0), Offset(0) {}
+  ScratchArena(const ScratchArena &) = delete;
+  ScratchArena &operator=(const ScratchArena &) = delete;
+
+  void *allocate(const std::size_t bytes,
+                 const std::size_t alignment = alignof(std::max_align_t));
+  template <typename T> T *allocate(const std::size_t count) {
+    return static_cast<T *>(allocate(sizeof(T) * count, alignof(T)));
+  }
+  Mark getMark() const { return {Block, Offset}; }
+  // Releases everything allocated since the mark was taken.
+  void rewind(const Mark &mark);
+
+  std::size_t getCapacity() const;
+
+private:
+  std::vector<std::unique_ptr<unsigned char[]>> Blocks;
+  std::vector<std::size_t> Sizes;
+  std::size_t Block, Offset;
+};
+
+////////////////////////////////////////////////////////////////////// TaskGraph
+
+// Tasks with dependencies, run by JobSystem::run(). A task starts once all
+// the tasks that precede it are done. The graph may be run again, e.g. every
+// frame, and must not be changed while it runs.
+//
+//   TaskGraph graph;
+//   const TaskGraph::TaskId transforms = graph.add([&] { ... });
+//   const TaskGraph::TaskId culling = graph.add([&] { ... });
+//   graph.precede(transforms, culling);
+//   jobs.run(graph);
+
+class TaskGraph final {
+public:
+  typedef std::function<void()> Task;
+  typedef std::size_t TaskId;
+
+  TaskGraph() = default;
+  TaskGraph(const TaskGraph &) = delete;
+  TaskGraph &operator=(const TaskGraph &) = delete;
+
+  TaskId add(Task task);
+  // after only starts once before is done.
+  void precede(const TaskId before, const TaskId after);
+  void clear() { Nodes.clear(); }
+  std::size_t size() const { return Nodes.size(); }
+
+private:
+  friend class JobSystem;
+  struct Node {
+    Task Work;
+    std::vector<TaskId> Successors;
+    std::size_t Predecessors = 0;
+    std::atomic<std::size_t> Remaining{0};
+  };
+  std::deque<Node> Nodes; // Never moved, Remaining is atomic
+};
+
+////////////////////////////////////////////////////////////////////// JobSystem
+
+// Pool of worker threads, each with a queue of jobs: a worker runs the jobs it
+// queued itself last in first out, and once out of them takes the oldest job
+// of the others, so that work spreads by stealing rather than through one
+// contended queue. Jobs queued by other threads go to a shared queue. Workers
+// with nothing to do park on a condition variable after yielding a few times.
+//
+// The calling thread runs jobs too while it waits, so parallelFor() and run()
+// may be called from any thread, tasks included, and the pool has one thread
+// less than the hardware. Tasks must not call OpenGL, as no context is current
+// on the workers. An exception thrown by a task is rethrown by the call that
+// ran it, once every other task is done.
+
+class JobSystem final {
+public:
+  typedef std::function<void(std::size_t begin, std::size_t end)> RangeTask;
+  typedef std::function<void(std::size_t index)> IndexTask;
+  static const std::size_t DEFAULT_GRAIN = 1024;
+
+  // 0 workers means one per hardware thread, but the calling one.
+  explicit JobSystem(std::size_t workers = 0);
+  ~JobSystem();
+  JobSystem(const JobSystem &) = delete;
+  JobSystem &operator=(const JobSystem &) = delete;
+
+  // Splits [0, count) into ranges of at least grain items, a few per thread so
+  // that the faster ones take more, and returns once all of them are done.
+  void parallelFor(const std::size_t count, const RangeTask &task,
+                   const std::size_t grain = DEFAULT_GRAIN);
+  // Calls task(index) once for each index in [0, count), in parallel.
+  void parallelInvoke(const std::size_t count, const IndexTask &task);
+  // Runs every task of the graph. Throws if its dependencies make a cycle.
+  void run(TaskGraph &graph);
+
+  // Threads that run jobs: the workers and the calling one.
+  std::size_t getThreadCount() const { return Threads.size() + 1; }
+  // Arena of the calling thread.
+  static ScratchArena &getScratch();
+  unsigned long getJobCount() const { return JobCount; }
+  // Jobs taken from the queue of another worker.
+  unsigned long getStealCount() const { return StealCount; }
+
+private:
+  struct Counter;
+  struct Job {
+    void (*Run)(JobSystem &jobs, Job &job);
+    void *Data;
+    std::size_t Index;
+    Counter *Group;
+  };
+  struct Queue {
+    std::mutex Mutex;
+    std::deque<Job *> Jobs;
+  };
+
+  std::vector<std::thread> Threads;
+  std::vector<std::unique_ptr<Queue>> Queues; // Per worker, then the shared one
+  std::atomic<std::size_t> Queued;
+  std::atomic<int> Sleeping;
+  std::atomic<bool> Stopping;
+  std::mutex ParkMutex;
+  std::condition_variable Wake;
+  std::atomic<unsigned long> JobCount, StealCount;
+
+  std::size_t getQueueIndex() const;
+  void push(Job *const *jobs, const std::size_t count);
+  Job *find(const std::size_t queue);
+  void execute(Job &job);
+  void wait(Counter &group, const std::size_t queue);
+  void workerLoop(const std::size_t worker);
+
+  static void runIndices(JobSystem &jobs, Job &job);
+  static void runNode(JobSystem &jobs, Job &job);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
+
+#endif /* MGL_JOBS_HPP */
@@ -0,0 +1,132 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Retained Offscreen Layer (OpenGL 4.5)
+//
+// Copyright (c)2022-25 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "./mglLayer.hpp"
+#include "./mglState.hpp"
+
+#include <iostream>
+#include <stdexcept>
+
+namespace mgl {
+
+////////////////////////////////////////////////////////////////////////// Layer
+
+// A triangle covering the viewport, on the far plane so that it passes the
+// depth test against a cleared depth buffer and leaves it unchanged. Texels
+// are fetched at the fragment position, the layer having the window size.
+static const char LAYER_VS[] = R"(#version 450 core
+void main() {
+  const vec2 corners[3] = vec2[](vec2(-1.0, -1.0), vec2(3.0, -1.0),
+                                 vec2(-1.0, 3.0));
+  gl_Position = vec4(corners[gl_VertexID], 1.0, 1.0);
+}
+)";
+
+static const char LAYER_FS[] = R"(#version 450 core
+layout(binding = 0) uniform sampler2D Layer;
+out vec4 outColor;
+void main() { outColor = texelFetch(Layer, ivec2(gl_FragCoord.xy), 0); }
+)";
+
+Layer::Layer()
+    : Framebuffer(0), Texture(0), Depth(0), VertexArray(0),
+      PreviousFramebuffer(0), Width(0), Height(0), Version(0), Valid(false),
+      RedrawCount(0), CompositeCount(0) {}
+
+Layer::~Layer() { destroy(); }
+
+bool Layer::isValid(const int width, const int height,
+                    const std::uint64_t version) const {
+  return Valid && width == Width && height == Height && version == Version;
+}
+
+void Layer::allocate(const int width, const int height) {
+  release();
+  glCreateTextures(GL_TEXTURE_2D, 1, &Texture);
+  glTextureStorage2D(Texture, 1, GL_RGBA8, width, height);
+  glCreateRenderbuffers(1, &Depth);
+  glNamedRenderbufferStorage(Depth, GL_DEPTH24_STENCIL8, width, height);
+  glCreateFramebuffers(1, &Framebuffer);
+  glNamedFramebufferTexture(Framebuffer, GL_COLOR_ATTACHMENT0, Texture, 0);
+  glNamedFramebufferRenderbuffer(Framebuffer, GL_DEPTH_STENCIL_ATTACHMENT,
+                                 GL_RENDERBUFFER, Depth);
+  const GLenum status =
+      glCheckNamedFramebufferStatus(Framebuffer, GL_FRAMEBUFFER);
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    std::cerr << "[ERROR] Layer framebuffer of " << width << "x" << height
+              << " is incomplete (0x" << std::hex << status << std::dec
+              << ")" << std::endl;
+    throw std::runtime_error("Incomplete layer framebuffer.");
+  }
+  Width = width;
+  Height = height;
+}
+
+void Layer::release() {
+  if (Framebuffer != 0) {
+    StateCache::getInstance().forgetFramebuffer(Framebuffer);
+    glDeleteFramebuffers(1, &Framebuffer);
+    glDeleteRenderbuffers(1, &Depth);
+    glDeleteTextures(1, &Texture);
+    Framebuffer = Depth = Texture = 0;
+  }
+  Width = Height = 0;
+  Valid = false;
+}
+
+void Layer::begin(const int width, const int height,
+                  const std::uint64_t version) {
+  if (Framebuffer == 0 || width != Width || height != Height) {
+    allocate(width, height);
+  }
+  StateCache &state = StateCache::getInstance();
+  PreviousFramebuffer = state.getFramebuffer();
+  state.bindFramebuffer(Framebuffer);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+  Version = version;
+  Valid = true;
+  RedrawCount++;
+}
+
+void Layer::end() {
+  StateCache::getInstance().bindFramebuffer(PreviousFramebuffer);
+}
+
+void Layer::composite() {
+  if (!Valid) {
+    return;
+  }
+  if (!Program) {
+    Program = std::make_unique<ShaderProgram>();
+    Program->addShaderSource(GL_VERTEX_SHADER, LAYER_VS, "mglLayer vertex");
+    Program->addShaderSource(GL_FRAGMENT_SHADER, LAYER_FS,
+                             "mglLayer fragment");
+    Program->create();
+    glCreateVertexArrays(1, &VertexArray);
+  }
+  StateCache &state = StateCache::getInstance();
+  state.useProgram(Program->ProgramId);
+  state.bindVertexArray(VertexArray);
+  state.disable(GL_BLEND);
+  glBindTextureUnit(0, Texture);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+  CompositeCount++;
+}
+
+void Layer::destroy() {
+  release();
+  if (Program) {
+    StateCache::getInstance().forgetVertexArray(VertexArray);
+    glDeleteVertexArrays(1, &VertexArray);
+    VertexArray = 0;
+    Program.reset();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
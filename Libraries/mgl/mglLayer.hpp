@@ -0,0 +1,77 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Retained Offscreen Layer (OpenGL 4.5)
+//
+// Copyright (c)2022-25 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MGL_LAYER_HPP
+#define MGL_LAYER_HPP
+
+#include "./mglShader.hpp"
+
+#include <cstdint>
+#include <memory>
+
+namespace mgl {
+
+class Layer;
+
+////////////////////////////////////////////////////////////////////////// Layer
+
+// Content drawn once into a framebuffer with a color texture and a depth
+// buffer, then composited on later frames by a single full-screen triangle.
+// The layer is tagged with the version of its content given to begin(), e.g.
+// a revision counter of the scene it holds: it must be redrawn when the
+// version or the size changes, or after invalidate().
+//
+//   if (!layer.isValid(width, height, version)) {
+//     layer.begin(width, height, version);
+//     ... draw the static content ...
+//     layer.end();
+//   }
+//   layer.composite();
+//   ... draw the dynamic content ...
+//
+// Compositing copies every pixel and leaves depth untouched, so the layer is
+// meant to be the background of the frame.
+
+class Layer final {
+public:
+  Layer();
+  ~Layer();
+  Layer(const Layer &) = delete;
+  Layer &operator=(const Layer &) = delete;
+
+  bool isValid(const int width, const int height,
+               const std::uint64_t version) const;
+  // Binds the layer framebuffer, reallocated if the size changed, and clears it.
+  void begin(const int width, const int height, const std::uint64_t version);
+  // Binds the framebuffer that was bound before begin() back.
+  void end();
+  void composite();
+  void invalidate() { Valid = false; }
+  void destroy();
+
+  GLuint getTexture() const { return Texture; }
+  unsigned long getRedrawCount() const { return RedrawCount; }
+  unsigned long getCompositeCount() const { return CompositeCount; }
+
+private:
+  GLuint Framebuffer, Texture, Depth, VertexArray;
+  GLuint PreviousFramebuffer;
+  std::unique_ptr<ShaderProgram> Program;
+  int Width, Height;
+  std::uint64_t Version;
+  bool Valid;
+  unsigned long RedrawCount, CompositeCount;
+
+  void allocate(const int width, const int height);
+  void release();
+};
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
+
+#endif /* MGL_LAYER_HPP */
@@ -0,0 +1,136 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// GPU Timer Queries (OpenGL 3.3)
+//
+// Copyright (c)2022-25 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "./mglProfiler.hpp"
+#include "./mglError.hpp"
+
+#include <cstring>
+#include <sstream>
+#include <string>
+
+namespace mgl {
+
+//////////////////////////////////////////////////////////////////// GpuProfiler
+
+GpuProfiler::GpuProfiler()
+    : Frames{}, Current(0), InFrame(false), Open{}, Depth(0), FrameCount(0),
+      DroppedFrames(0) {}
+
+void GpuProfiler::create() {
+  // Every query is made once, and reused when its frame comes round again
+  for (Frame &frame : Frames) {
+    for (Marker &marker : frame.markers) {
+      glGenQueries(2, marker.queries);
+    }
+  }
+}
+
+void GpuProfiler::destroy() {
+  if (Frames[0].markers[0].queries[0] != 0) {
+    for (Frame &frame : Frames) {
+      for (Marker &marker : frame.markers) {
+        glDeleteQueries(2, marker.queries);
+        marker.queries[0] = marker.queries[1] = 0;
+      }
+      frame.count = 0;
+      frame.pending = false;
+    }
+  }
+}
+
+TimeHistogram &GpuProfiler::getPass(const char *name) {
+  for (auto &pass : Passes) {
+    if (pass.first == name || std::strcmp(pass.first, name) == 0) {
+      return pass.second;
+    }
+  }
+  Passes.emplace_back(name, TimeHistogram());
+  return Passes.back().second;
+}
+
+void GpuProfiler::collect(Frame &frame) {
+  // Queries complete in order, but a region may end before an earlier one
+  for (int i = 0; i < frame.count; i++) {
+    GLint available = 0;
+    glGetQueryObjectiv(frame.markers[i].queries[1], GL_QUERY_RESULT_AVAILABLE,
+                       &available);
+    if (!available) {
+      DroppedFrames++;
+      return;
+    }
+  }
+  for (int i = 0; i < frame.count; i++) {
+    const Marker &marker = frame.markers[i];
+    GLuint64 begin = 0, end = 0;
+    glGetQueryObjectui64v(marker.queries[0], GL_QUERY_RESULT, &begin);
+    glGetQueryObjectui64v(marker.queries[1], GL_QUERY_RESULT, &end);
+    getPass(marker.name).record(end > begin ? (end - begin) * 1e-9 : 0.0);
+  }
+  FrameCount++;
+}
+
+void GpuProfiler::beginFrame() {
+  if (Frames[0].markers[0].queries[0] == 0) {
+    create();
+  }
+  Current = (Current + 1) % FRAMES;
+  Frame &frame = Frames[Current];
+  if (frame.pending) {
+    collect(frame);
+  }
+  frame.count = 0;
+  frame.pending = false;
+  InFrame = true;
+}
+
+void GpuProfiler::endFrame() {
+  Frames[Current].pending = InFrame && Frames[Current].count > 0;
+  InFrame = false;
+}
+
+void GpuProfiler::begin(const char *name) {
+  pushDebugGroup(name);
+  Frame &frame = Frames[Current];
+  int marker = -1;
+  if (InFrame && frame.count < MARKERS) {
+    marker = frame.count++;
+    frame.markers[marker].name = name;
+    glQueryCounter(frame.markers[marker].queries[0], GL_TIMESTAMP);
+  }
+  if (Depth < MARKERS) {
+    Open[Depth] = marker;
+  }
+  Depth++;
+}
+
+void GpuProfiler::end() {
+  if (Depth == 0) {
+    return;
+  }
+  Depth--;
+  if (Depth < MARKERS && Open[Depth] >= 0 && InFrame) {
+    Marker &marker = Frames[Current].markers[Open[Depth]];
+    glQueryCounter(marker.queries[1], GL_TIMESTAMP);
+  }
+  popDebugGroup();
+}
+
+void GpuProfiler::report(std::ostream &out) const {
+  std::ostringstream text;
+  const std::string frames = std::to_string(FrameCount);
+  writeTimingHeader(text, "GPU timing over " + frames + " frames");
+  for (const auto &pass : Passes) {
+    writeTimingRow(text, pass.first, pass.second);
+  }
+  text << DroppedFrames << " frames dropped, not done after " << FRAMES
+       << " frames";
+  out << text.str() << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
@@ -0,0 +1,118 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// GPU Timer Queries (OpenGL 3.3)
+//
+// Copyright (c)2022-25 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MGL_PROFILER_HPP
+#define MGL_PROFILER_HPP
+
+#include <GL/glew.h>
+
+#include <array>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include "./mglTiming.hpp"
+
+namespace mgl {
+
+class GpuProfiler;
+class GpuScope;
+
+//////////////////////////////////////////////////////////////////// GpuProfiler
+
+// GPU time of the passes of each frame. A pass is a region between begin()
+// and end(), or the lifetime of a GpuScope, and regions may nest. Each bound
+// of a region is a GL_TIMESTAMP query, so the time is the one the GPU takes
+// from the commands before the region up to its last command. Queries of a
+// frame are read back FRAMES frames later, when they are long done: frames
+// whose results are still not available are dropped rather than waited for.
+// Every region is also a debug group, see pushDebugGroup().
+//
+//   profiler.beginFrame();
+//   {
+//     GpuScope scope(profiler, "pieces");  // names must outlive the profiler
+//     ... draws ...
+//   }
+//   profiler.endFrame();
+
+class GpuProfiler final {
+public:
+  static const int FRAMES = 4;
+  static const int MARKERS = 32; // Regions timed per frame, the others only
+                                 // open a debug group
+
+  GpuProfiler();
+
+  GpuProfiler(const GpuProfiler &) = delete;
+  GpuProfiler &operator=(const GpuProfiler &) = delete;
+
+  // Collects the frame issued FRAMES frames ago, without blocking.
+  void beginFrame();
+  void endFrame();
+  void begin(const char *name);
+  void end();
+  // Deletes the queries, while the context is current.
+  void destroy();
+
+  std::size_t getPassCount() const { return Passes.size(); }
+  const char *getPassName(const std::size_t pass) const {
+    return Passes[pass].first;
+  }
+  const TimeHistogram &getPass(const std::size_t pass) const {
+    return Passes[pass].second;
+  }
+  // Frames whose results were read back, and dropped.
+  unsigned long getFrameCount() const { return FrameCount; }
+  unsigned long getDroppedFrames() const { return DroppedFrames; }
+  void report(std::ostream &out) const;
+
+private:
+  struct Marker {
+    const char *name;
+    GLuint queries[2];
+  };
+  struct Frame {
+    std::array<Marker, MARKERS> markers;
+    int count;
+    bool pending;
+  };
+
+  std::array<Frame, FRAMES> Frames;
+  int Current;
+  bool InFrame;
+  std::array<int, MARKERS> Open; // Markers of the open regions, -1 if untimed
+  int Depth;
+  std::vector<std::pair<const char *, TimeHistogram>> Passes;
+  unsigned long FrameCount;
+  unsigned long DroppedFrames;
+
+  void create();
+  void collect(Frame &frame);
+  TimeHistogram &getPass(const char *name);
+};
+
+/////////////////////////////////////////////////////////////////////// GpuScope
+
+class GpuScope final {
+public:
+  GpuScope(GpuProfiler &profiler, const char *name) : Profiler(profiler) {
+    Profiler.begin(name);
+  }
+  ~GpuScope() { Profiler.end(); }
+
+  GpuScope(const GpuScope &) = delete;
+  GpuScope &operator=(const GpuScope &) = delete;
+
+private:
+  GpuProfiler &Profiler;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
+
+#endif /* MGL_PROFILER_HPP */
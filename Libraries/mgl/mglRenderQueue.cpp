@@ -0,0 +1,128 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Sort-Keyed Render Queue
+//
+// Copyright (c)2022-25 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "./mglRenderQueue.hpp"
+#include "./mglState.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace mgl {
+
+//////////////////////////////////////////////////////////////////// RenderQueue
+
+RenderQueue::RenderQueue() : ProgramSwitches(0), VertexArraySwitches(0) {}
+
+std::uint16_t
+RenderQueue::denseId(std::unordered_map<GLuint, std::uint16_t> &ids,
+                     const GLuint name) {
+  // Small ids assigned on first use, so that any GL name fits in the key.
+  // They only need to be consistent until the queue is cleared
+  auto it = ids.find(name);
+  if (it == ids.end()) {
+    if (ids.size() > 0xFFFF) {
+      std::cerr << "[ERROR] More than 65536 programs or vertex arrays queued."
+                << std::endl;
+      throw std::runtime_error(
+          "More than 65536 programs or vertex arrays queued.");
+    }
+    it = ids.emplace(name, static_cast<std::uint16_t>(ids.size())).first;
+  }
+  return it->second;
+}
+
+void RenderQueue::submit(const std::uint8_t layer, const DrawItem &item,
+                         const std::uint32_t order) {
+  const std::uint64_t key =
+      (std::uint64_t(layer) << 56) |
+      (std::uint64_t(denseId(ProgramIds, item.program)) << 40) |
+      (std::uint64_t(denseId(VertexArrayIds, item.vao)) << 24) |
+      (order & 0xFFFFFF);
+  Order.push_back(static_cast<std::uint32_t>(Items.size()));
+  Keys.push_back(key);
+  Items.push_back(item);
+}
+
+void RenderQueue::sort() {
+  // LSD radix sort on bytes, skipping the bytes that are the same in every key
+  const std::size_t count = Keys.size();
+  SortedKeys.resize(count);
+  SortedOrder.resize(count);
+  for (int shift = 0; shift < 64; shift += 8) {
+    std::size_t histogram[257] = {};
+    for (const std::uint64_t key : Keys) {
+      histogram[((key >> shift) & 0xFF) + 1]++;
+    }
+    if (std::any_of(histogram + 1, histogram + 257,
+                    [count](std::size_t n) { return n == count; })) {
+      continue;
+    }
+    for (int digit = 0; digit < 256; digit++) {
+      histogram[digit + 1] += histogram[digit];
+    }
+    for (std::size_t i = 0; i < count; i++) {
+      const std::size_t dst = histogram[(Keys[i] >> shift) & 0xFF]++;
+      SortedKeys[dst] = Keys[i];
+      SortedOrder[dst] = Order[i];
+    }
+    Keys.swap(SortedKeys);
+    Order.swap(SortedOrder);
+  }
+}
+
+void RenderQueue::flush() {
+  StateCache &state = StateCache::getInstance();
+  ProgramSwitches = 0;
+  VertexArraySwitches = 0;
+  const DrawItem *previous = nullptr;
+  for (const std::uint32_t index : Order) {
+    const DrawItem &item = Items[index];
+    if (!previous || item.program != previous->program) {
+      state.useProgram(item.program);
+      ProgramSwitches++;
+    }
+    if (!previous || item.vao != previous->vao) {
+      state.bindVertexArray(item.vao);
+      VertexArraySwitches++;
+    }
+    if (item.setup && (!previous || item.setup != previous->setup ||
+                       item.setup_data != previous->setup_data)) {
+      item.setup(item.setup_data);
+    }
+    if (item.indirect != 0) {
+      state.bindBuffer(GL_DRAW_INDIRECT_BUFFER, item.indirect);
+      glMultiDrawElementsIndirect(
+          item.mode, item.index_type,
+          reinterpret_cast<const void *>(item.indirect_offset),
+          item.draw_count, 0);
+    } else {
+      const GLsizei index_size = item.index_type == GL_UNSIGNED_BYTE    ? 1
+                                 : item.index_type == GL_UNSIGNED_SHORT ? 2
+                                                                        : 4;
+      glDrawElementsInstancedBaseVertexBaseInstance(
+          item.mode, item.index_count, item.index_type,
+          reinterpret_cast<const void *>(std::uintptr_t(item.first_index) *
+                                         index_size),
+          item.instance_count, item.base_vertex, item.base_instance);
+    }
+    previous = &item;
+  }
+  clear();
+}
+
+void RenderQueue::clear() {
+  Items.clear();
+  Keys.clear();
+  Order.clear();
+  ProgramIds.clear();
+  VertexArrayIds.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
@@ -0,0 +1,95 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Sort-Keyed Render Queue
+//
+// Copyright (c)2022-25 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MGL_RENDER_QUEUE_HPP
+#define MGL_RENDER_QUEUE_HPP
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace mgl {
+
+class RenderQueue;
+
+/////////////////////////////////////////////////////////////////////// DrawItem
+
+// An indexed draw of instance_count instances of a mesh, or, if indirect is
+// not 0, of the draw_count commands stored in an indirect buffer at
+// indirect_offset. Per-instance data is fetched by the shaders from the
+// instance range [base_instance, base_instance + instance_count). setup, if
+// any, is called with setup_data before the draw unless the previous item had
+// the same ones, e.g. to bind storage blocks or set uniforms.
+
+struct DrawItem {
+  GLuint program;
+  GLuint vao;
+  GLenum mode;
+  GLenum index_type;
+  GLsizei index_count;
+  GLuint first_index;
+  GLint base_vertex;
+  GLuint instance_count;
+  GLuint base_instance;
+  GLuint indirect;
+  GLintptr indirect_offset;
+  GLsizei draw_count;
+  void (*setup)(void *data);
+  void *setup_data;
+};
+
+//////////////////////////////////////////////////////////////////// RenderQueue
+
+// Draw items are submitted in any order, each with a 64-bit sort key:
+//
+//   63      56 55          40 39          24 23               0
+//   [ layer  ] [  program   ] [    vao     ] [     order      ]
+//
+// Layers are drawn back to front. Within a layer, items sharing a program are
+// drawn together and, for a program, items sharing a vertex array, so that the
+// number of state changes follows the number of distinct programs and vertex
+// arrays rather than the number of items. order is left to the application,
+// e.g. depth. Keys are sorted with a radix sort and items with equal keys keep
+// their submission order. Programs and vertex arrays are numbered in the order
+// they are first submitted since the queue was last cleared, so up to 65536 of
+// each may be queued at once.
+
+class RenderQueue final {
+public:
+  RenderQueue();
+
+  void submit(const std::uint8_t layer, const DrawItem &item,
+              const std::uint32_t order = 0);
+  void sort();
+  // Issues the sorted items through the StateCache and clears the queue.
+  void flush();
+  void clear();
+
+  std::size_t size() const { return Items.size(); }
+  // Program and vertex array switches made by the last flush.
+  unsigned long getProgramSwitches() const { return ProgramSwitches; }
+  unsigned long getVertexArraySwitches() const { return VertexArraySwitches; }
+
+private:
+  std::vector<DrawItem> Items;
+  std::vector<std::uint64_t> Keys, SortedKeys;
+  std::vector<std::uint32_t> Order, SortedOrder;
+  std::unordered_map<GLuint, std::uint16_t> ProgramIds, VertexArrayIds;
+  unsigned long ProgramSwitches;
+  unsigned long VertexArraySwitches;
+
+  static std::uint16_t denseId(std::unordered_map<GLuint, std::uint16_t> &ids,
+                               const GLuint name);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
+
+#endif /* MGL_RENDER_QUEUE_HPP */
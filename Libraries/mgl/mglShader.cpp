@@ -7,11 +7,16 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "./mglShader.hpp"
+#include "./mglState.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <vector>
 
+#include <glm/gtc/type_ptr.hpp>
+
 namespace mgl {
 
 ////////////////////////////////////////////////////////////////// ShaderProgram
@@ -56,21 +61,28 @@ void ShaderProgram::checkLinkage() {
   }
 }
 
-ShaderProgram::ShaderProgram() : ProgramId(glCreateProgram()) {}
+ShaderProgram::ShaderProgram()
+    : ProgramId(glCreateProgram()), UniformUploads(0), UniformsElided(0) {}
 
 ShaderProgram::~ShaderProgram() {
-  glUseProgram(0);
+  StateCache::getInstance().useProgram(0);
+  StateCache::getInstance().forgetProgram(ProgramId);
   glDeleteProgram(ProgramId);
 }
 
 void ShaderProgram::addShader(const GLenum shader_type,
                               const std::string &filename) {
+  addShaderSource(shader_type, read(filename), filename);
+}
+
+void ShaderProgram::addShaderSource(const GLenum shader_type,
+                                    const std::string &source,
+                                    const std::string &name) {
   const GLuint shader_id = glCreateShader(shader_type);
-  const std::string scode = read(filename);
-  const GLchar *code = scode.c_str();
+  const GLchar *code = source.c_str();
   glShaderSource(shader_id, 1, &code, 0);
   glCompileShader(shader_id);
-  checkCompilation(shader_id, filename);
+  checkCompilation(shader_id, name);
   glAttachShader(ProgramId, shader_id);
 
   Shaders[shader_type] = {shader_id};
@@ -106,13 +118,26 @@ void ShaderProgram::addUniformBlock(const std::string &name,
     std::cerr << "[WARNING] Uniform block " << name << " already exists"
               << std::endl;
   }
-  Ubos[name] = {0, binding_point};
+  Ubos[name] = {0, binding_point, 0};
 }
 
 bool ShaderProgram::isUniformBlock(const std::string &name) {
   return Ubos.find(name) != Ubos.end();
 }
 
+void ShaderProgram::addStorageBlock(const std::string &name,
+                                    const GLuint binding_point) {
+  if (isStorageBlock(name)) {
+    std::cerr << "[WARNING] Storage block " << name << " already exists"
+              << std::endl;
+  }
+  Ssbos[name] = {0, binding_point, 0};
+}
+
+bool ShaderProgram::isStorageBlock(const std::string &name) {
+  return Ssbos.find(name) != Ssbos.end();
+}
+
 void ShaderProgram::create() {
   glLinkProgram(ProgramId);
   checkLinkage();
@@ -121,22 +146,133 @@ void ShaderProgram::create() {
     glDeleteShader(i.second);
   }
 
+  // Values of a freshly linked program are unknown
+  GLint max_location = -1;
   for (auto &i : Uniforms) {
     i.second.index = glGetUniformLocation(ProgramId, i.first.c_str());
     if (i.second.index < 0)
       std::cerr << "WARNING: Uniform " << i.first << " not found." << std::endl;
+    max_location = std::max(max_location, i.second.index);
   }
+  Shadows.assign(max_location + 1, UniformShadow{{}, 0});
   for (auto &i : Ubos) {
     i.second.index = glGetUniformBlockIndex(ProgramId, i.first.c_str());
     if (i.second.index == GL_INVALID_INDEX)
       std::cerr << "WARNING: UBO " << i.first << " not found." << std::endl;
     glUniformBlockBinding(ProgramId, i.second.index, i.second.binding_point);
+    glGetActiveUniformBlockiv(ProgramId, i.second.index,
+                              GL_UNIFORM_BLOCK_DATA_SIZE, &i.second.size);
   }
+  for (auto &i : Ssbos) {
+    i.second.index = glGetProgramResourceIndex(
+        ProgramId, GL_SHADER_STORAGE_BLOCK, i.first.c_str());
+    if (i.second.index == GL_INVALID_INDEX) {
+      std::cerr << "WARNING: SSBO " << i.first << " not found." << std::endl;
+      continue;
+    }
+    glShaderStorageBlockBinding(ProgramId, i.second.index,
+                                i.second.binding_point);
+    // The stride of the array is that of its first member, if it is one
+    const GLenum block_props[] = {GL_BUFFER_DATA_SIZE, GL_NUM_ACTIVE_VARIABLES};
+    GLint block_values[2] = {0, 0};
+    glGetProgramResourceiv(ProgramId, GL_SHADER_STORAGE_BLOCK, i.second.index,
+                           2, block_props, 2, nullptr, block_values);
+    i.second.stride = block_values[0];
+    if (block_values[1] > 0) {
+      const GLenum variables_prop = GL_ACTIVE_VARIABLES;
+      std::vector<GLint> variables(block_values[1]);
+      glGetProgramResourceiv(ProgramId, GL_SHADER_STORAGE_BLOCK,
+                             i.second.index, 1, &variables_prop,
+                             block_values[1], nullptr, variables.data());
+      const GLenum stride_prop = GL_TOP_LEVEL_ARRAY_STRIDE;
+      GLint stride = 0;
+      glGetProgramResourceiv(ProgramId, GL_BUFFER_VARIABLE, variables[0], 1,
+                             &stride_prop, 1, nullptr, &stride);
+      if (stride > 0) {
+        i.second.stride = stride;
+      }
+    }
+  }
+}
+
+void ShaderProgram::bind() {
+  StateCache::getInstance().useProgram(ProgramId);
 }
 
-void ShaderProgram::bind() { glUseProgram(ProgramId); }
+void ShaderProgram::unbind() { StateCache::getInstance().useProgram(0); }
 
-void ShaderProgram::unbind() { glUseProgram(0); }
+/////////////////////////////////////////////////////////////////////// UNIFORMS
+
+UniformId ShaderProgram::getUniformId(const std::string &name) {
+  auto it = Uniforms.find(name);
+  if (it == Uniforms.end()) {
+    std::cerr << "[WARNING] Uniform " << name << " was not added" << std::endl;
+    return -1;
+  }
+  return it->second.index;
+}
+
+bool ShaderProgram::changed(const UniformId id, const void *value,
+                            const GLsizei size) {
+  if (id < 0) {
+    return false;
+  }
+  if (static_cast<std::size_t>(id) >= Shadows.size()) {
+    // Location not registered with addUniform
+    Shadows.resize(id + 1, UniformShadow{{}, 0});
+  }
+  UniformShadow &shadow = Shadows[id];
+  if (shadow.size == size && std::memcmp(shadow.value, value, size) == 0) {
+    UniformsElided++;
+    return false;
+  }
+  std::memcpy(shadow.value, value, size);
+  shadow.size = size;
+  UniformUploads++;
+  return true;
+}
+
+void ShaderProgram::set(const UniformId id, const GLfloat value) {
+  if (changed(id, &value, sizeof(value)))
+    glProgramUniform1f(ProgramId, id, value);
+}
+
+void ShaderProgram::set(const UniformId id, const GLint value) {
+  if (changed(id, &value, sizeof(value)))
+    glProgramUniform1i(ProgramId, id, value);
+}
+
+void ShaderProgram::set(const UniformId id, const GLuint value) {
+  if (changed(id, &value, sizeof(value)))
+    glProgramUniform1ui(ProgramId, id, value);
+}
+
+void ShaderProgram::set(const UniformId id, const glm::vec2 &value) {
+  if (changed(id, glm::value_ptr(value), sizeof(value)))
+    glProgramUniform2fv(ProgramId, id, 1, glm::value_ptr(value));
+}
+
+void ShaderProgram::set(const UniformId id, const glm::vec3 &value) {
+  if (changed(id, glm::value_ptr(value), sizeof(value)))
+    glProgramUniform3fv(ProgramId, id, 1, glm::value_ptr(value));
+}
+
+void ShaderProgram::set(const UniformId id, const glm::vec4 &value) {
+  if (changed(id, glm::value_ptr(value), sizeof(value)))
+    glProgramUniform4fv(ProgramId, id, 1, glm::value_ptr(value));
+}
+
+void ShaderProgram::set(const UniformId id, const glm::mat3 &value) {
+  if (changed(id, glm::value_ptr(value), sizeof(value)))
+    glProgramUniformMatrix3fv(ProgramId, id, 1, GL_FALSE,
+                              glm::value_ptr(value));
+}
+
+void ShaderProgram::set(const UniformId id, const glm::mat4 &value) {
+  if (changed(id, glm::value_ptr(value), sizeof(value)))
+    glProgramUniformMatrix4fv(ProgramId, id, 1, GL_FALSE,
+                              glm::value_ptr(value));
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 } // namespace mgl
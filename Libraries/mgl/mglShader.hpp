@@ -10,14 +10,19 @@
 #define MGL_SHADER_HPP
 
 #include <GL/glew.h>
+#include <glm/glm.hpp>
 
 #include <map>
 #include <string>
+#include <vector>
 
 namespace mgl {
 
 class ShaderProgram;
 
+// Location of a uniform in a linked program, as in Uniforms[name].index.
+typedef GLint UniformId;
+
 ////////////////////////////////////////////////////////////////// ShaderProgram
 
 class ShaderProgram final {
@@ -42,9 +47,17 @@ public:
   struct UboInfo {
     GLuint index;
     GLuint binding_point;
+    GLint size;
   };
   std::map<std::string, UboInfo> Ubos;
 
+  struct SsboInfo {
+    GLuint index;
+    GLuint binding_point;
+    GLint stride; // Of the top-level array, or the block size if none
+  };
+  std::map<std::string, SsboInfo> Ssbos;
+
   ShaderProgram();
   ~ShaderProgram();
 
@@ -54,17 +67,49 @@ public:
   ShaderProgram &operator=(ShaderProgram &&other) noexcept;
 
   void addShader(const GLenum shader_type, const std::string &filename);
+  // Same with the code given in place, name is only used in error messages.
+  void addShaderSource(const GLenum shader_type, const std::string &source,
+                       const std::string &name);
   void addAttribute(const std::string &name, const GLuint index);
   bool isAttribute(const std::string &name);
   void addUniform(const std::string &name);
   bool isUniform(const std::string &name);
   void addUniformBlock(const std::string &name, const GLuint binding_point);
   bool isUniformBlock(const std::string &name);
+  void addStorageBlock(const std::string &name, const GLuint binding_point);
+  bool isStorageBlock(const std::string &name);
   void create();
   void bind();
   void unbind();
 
+  // Typed setters, which do not need the program to be bound. The last value
+  // uploaded to each location is shadowed and identical values are skipped,
+  // so uniforms must not be set with glUniform* behind the program's back.
+  // Unknown locations (-1) are ignored, as by OpenGL.
+  UniformId getUniformId(const std::string &name);
+  void set(const UniformId id, const GLfloat value);
+  void set(const UniformId id, const GLint value);
+  void set(const UniformId id, const GLuint value);
+  void set(const UniformId id, const glm::vec2 &value);
+  void set(const UniformId id, const glm::vec3 &value);
+  void set(const UniformId id, const glm::vec4 &value);
+  void set(const UniformId id, const glm::mat3 &value);
+  void set(const UniformId id, const glm::mat4 &value);
+
+  unsigned long getUniformUploads() const { return UniformUploads; }
+  unsigned long getUniformsElided() const { return UniformsElided; }
+
 private:
+  struct UniformShadow {
+    GLfloat value[16];
+    GLsizei size; // In bytes, 0 until the first upload
+  };
+  std::vector<UniformShadow> Shadows; // Indexed by location
+  unsigned long UniformUploads;
+  unsigned long UniformsElided;
+
+  bool changed(const UniformId id, const void *value, const GLsizei size);
+
   const std::string read(const std::string &filename);
   void checkCompilation(const GLuint shader_id, const std::string &filename);
   void checkLinkage();
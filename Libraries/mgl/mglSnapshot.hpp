@@ -0,0 +1,79 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Scene Snapshots
+//
+// Copyright (c)2022-25 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MGL_SNAPSHOT_HPP
+#define MGL_SNAPSHOT_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace mgl {
+
+template <typename T> class TripleBuffer;
+
+/////////////////////////////////////////////////////////////////// TripleBuffer
+
+// Hands snapshots of a scene from one writer thread to one reader thread
+// without locks or copies between them. Each thread owns one of the three
+// slots, and the third holds the last snapshot published: publish() trades
+// the slot of the writer for it and acquire() trades the slot of the reader
+// for it, each with a single atomic exchange. The writer never waits for the
+// reader, and the reader always gets the latest snapshot, those published in
+// between are dropped. Slots are reused, so a snapshot may start out holding
+// the contents of an older one.
+//
+//   // Writer, e.g. App::snapshotCallback on the main thread
+//   Snapshot &next = buffer.getBack();
+//   ... fill next ...
+//   buffer.publish();
+//
+//   // Reader, e.g. App::displayCallback on the render thread
+//   buffer.acquire();
+//   const Snapshot &scene = buffer.getFront();
+
+template <typename T> class TripleBuffer final {
+public:
+  TripleBuffer() : Back(0), Middle(1), Front(2) {}
+
+  TripleBuffer(const TripleBuffer &) = delete;
+  TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+  // Slot of the writer.
+  T &getBack() { return Slots[Back]; }
+  void publish() {
+    // Release, so that the reader sees the slot as written
+    Back = Middle.exchange(Back | FRESH, std::memory_order_acq_rel) & ~FRESH;
+  }
+
+  // Takes the last snapshot published, if any since the last call. Returns
+  // false, keeping the current one, otherwise.
+  bool acquire() {
+    if ((Middle.load(std::memory_order_relaxed) & FRESH) == 0) {
+      return false;
+    }
+    Front = Middle.exchange(Front, std::memory_order_acq_rel) & ~FRESH;
+    return true;
+  }
+  // Slot of the reader, the last snapshot acquired.
+  T &getFront() { return Slots[Front]; }
+  const T &getFront() const { return Slots[Front]; }
+
+private:
+  static const std::uint8_t FRESH = 4; // Published and not yet acquired
+
+  std::array<T, 3> Slots;
+  std::uint8_t Back;
+  std::atomic<std::uint8_t> Middle; // Slot index, and FRESH
+  std::uint8_t Front;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
+
+#endif /* MGL_SNAPSHOT_HPP */
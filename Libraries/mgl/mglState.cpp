@@ -0,0 +1,170 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// OpenGL State Cache
+//
+// Copyright (c)2022-25 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "./mglState.hpp"
+
+namespace mgl {
+
+///////////////////////////////////////////////////////////////////// StateCache
+
+// Name of an object whose binding is not known.
+static const GLuint UNKNOWN = 0xFFFFFFFF;
+
+StateCache::StateCache()
+    : Program(UNKNOWN), VertexArray(UNKNOWN), Framebuffer(UNKNOWN),
+      Changes(0), Elided(0),
+      FrameChanges(0), FrameElided(0), TotalChanges(0), TotalElided(0) {}
+
+StateCache &StateCache::getInstance() {
+  static StateCache instance;
+  return instance;
+}
+
+bool StateCache::change(const bool needed) {
+  if (needed) {
+    Changes++;
+  } else {
+    Elided++;
+  }
+  return needed;
+}
+
+void StateCache::useProgram(const GLuint program) {
+  if (change(program != Program)) {
+    glUseProgram(program);
+    Program = program;
+  }
+}
+
+void StateCache::bindVertexArray(const GLuint vao) {
+  if (change(vao != VertexArray)) {
+    glBindVertexArray(vao);
+    VertexArray = vao;
+    // The element array buffer binding belongs to the vertex array
+    Buffers.erase(GL_ELEMENT_ARRAY_BUFFER);
+  }
+}
+
+void StateCache::bindFramebuffer(const GLuint framebuffer) {
+  if (change(framebuffer != Framebuffer)) {
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    Framebuffer = framebuffer;
+  }
+}
+
+void StateCache::bindBuffer(const GLenum target, const GLuint buffer) {
+  auto it = Buffers.find(target);
+  if (change(it == Buffers.end() || it->second != buffer)) {
+    glBindBuffer(target, buffer);
+    Buffers[target] = buffer;
+  }
+}
+
+void StateCache::bindBufferBase(const GLenum target, const GLuint index,
+                                const GLuint buffer) {
+  const IndexedBinding binding = {buffer, 0, 0};
+  auto it = IndexedBuffers.find({target, index});
+  if (change(it == IndexedBuffers.end() || it->second.buffer != buffer ||
+             it->second.offset != 0 || it->second.size != 0)) {
+    glBindBufferBase(target, index, buffer);
+    IndexedBuffers[{target, index}] = binding;
+    // Indexed binds also bind the generic binding point
+    Buffers[target] = buffer;
+  }
+}
+
+void StateCache::bindBufferRange(const GLenum target, const GLuint index,
+                                 const GLuint buffer, const GLintptr offset,
+                                 const GLsizeiptr size) {
+  const IndexedBinding binding = {buffer, offset, size};
+  auto it = IndexedBuffers.find({target, index});
+  if (change(it == IndexedBuffers.end() || it->second.buffer != buffer ||
+             it->second.offset != offset || it->second.size != size)) {
+    glBindBufferRange(target, index, buffer, offset, size);
+    IndexedBuffers[{target, index}] = binding;
+    Buffers[target] = buffer;
+  }
+}
+
+void StateCache::enable(const GLenum capability) {
+  auto it = Capabilities.find(capability);
+  if (change(it == Capabilities.end() || !it->second)) {
+    glEnable(capability);
+    Capabilities[capability] = true;
+  }
+}
+
+void StateCache::disable(const GLenum capability) {
+  auto it = Capabilities.find(capability);
+  if (change(it == Capabilities.end() || it->second)) {
+    glDisable(capability);
+    Capabilities[capability] = false;
+  }
+}
+
+////////////////////////////////////////////////////////////////// FORGET STATE
+
+void StateCache::forgetProgram(const GLuint program) {
+  if (Program == program) {
+    Program = UNKNOWN;
+  }
+}
+
+void StateCache::forgetVertexArray(const GLuint vao) {
+  if (VertexArray == vao) {
+    VertexArray = UNKNOWN;
+    Buffers.erase(GL_ELEMENT_ARRAY_BUFFER);
+  }
+}
+
+void StateCache::forgetFramebuffer(const GLuint framebuffer) {
+  if (Framebuffer == framebuffer) {
+    Framebuffer = UNKNOWN;
+  }
+}
+
+void StateCache::forgetBuffer(const GLuint buffer) {
+  for (auto it = Buffers.begin(); it != Buffers.end();) {
+    it = it->second == buffer ? Buffers.erase(it) : std::next(it);
+  }
+  for (auto it = IndexedBuffers.begin(); it != IndexedBuffers.end();) {
+    it = it->second.buffer == buffer ? IndexedBuffers.erase(it) : std::next(it);
+  }
+}
+
+void StateCache::invalidate() {
+  Program = UNKNOWN;
+  VertexArray = UNKNOWN;
+  Framebuffer = UNKNOWN;
+  Buffers.clear();
+  IndexedBuffers.clear();
+  Capabilities.clear();
+}
+
+GLuint StateCache::getFramebuffer() {
+  if (Framebuffer == UNKNOWN) {
+    GLint framebuffer;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+    Framebuffer = static_cast<GLuint>(framebuffer);
+  }
+  return Framebuffer;
+}
+
+////////////////////////////////////////////////////////////////////// COUNTERS
+
+void StateCache::endFrame() {
+  FrameChanges = Changes;
+  FrameElided = Elided;
+  TotalChanges += Changes;
+  TotalElided += Elided;
+  Changes = 0;
+  Elided = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
@@ -0,0 +1,93 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// OpenGL State Cache
+//
+// Copyright (c)2022-25 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MGL_STATE_HPP
+#define MGL_STATE_HPP
+
+#include <GL/glew.h>
+
+#include <map>
+#include <utility>
+
+namespace mgl {
+
+class StateCache;
+
+///////////////////////////////////////////////////////////////////// StateCache
+
+// Shadow of the OpenGL state changed through mgl: current program, vertex
+// array, framebuffer, buffer bindings (plain and indexed) and enabled
+// capabilities. A change
+// to the value already current is not issued. The cache must see every change
+// to the state it tracks: code making GL calls behind its back must call
+// invalidate(), and objects must be forgotten when deleted since OpenGL unbinds
+// them and their names can be reused.
+
+class StateCache final {
+public:
+  static StateCache &getInstance();
+
+  void useProgram(const GLuint program);
+  void bindVertexArray(const GLuint vao);
+  // Binds both the draw and read framebuffers.
+  void bindFramebuffer(const GLuint framebuffer);
+  void bindBuffer(const GLenum target, const GLuint buffer);
+  void bindBufferBase(const GLenum target, const GLuint index,
+                      const GLuint buffer);
+  void bindBufferRange(const GLenum target, const GLuint index,
+                       const GLuint buffer, const GLintptr offset,
+                       const GLsizeiptr size);
+  void enable(const GLenum capability);
+  void disable(const GLenum capability);
+
+  void forgetProgram(const GLuint program);
+  void forgetVertexArray(const GLuint vao);
+  void forgetFramebuffer(const GLuint framebuffer);
+  void forgetBuffer(const GLuint buffer);
+  void invalidate();
+
+  // Queried from OpenGL if not known.
+  GLuint getFramebuffer();
+
+  // Called by the Engine after each frame.
+  void endFrame();
+  // State changes issued and elided during the last frame, and in total.
+  unsigned long getFrameChanges() const { return FrameChanges; }
+  unsigned long getFrameElided() const { return FrameElided; }
+  unsigned long getTotalChanges() const { return TotalChanges + Changes; }
+  unsigned long getTotalElided() const { return TotalElided + Elided; }
+
+private:
+  struct IndexedBinding {
+    GLuint buffer;
+    GLintptr offset;
+    GLsizeiptr size; // 0 for the whole buffer
+  };
+
+  GLuint Program;
+  GLuint VertexArray;
+  GLuint Framebuffer;
+  std::map<GLenum, GLuint> Buffers;
+  std::map<std::pair<GLenum, GLuint>, IndexedBinding> IndexedBuffers;
+  std::map<GLenum, bool> Capabilities;
+  unsigned long Changes, Elided;
+  unsigned long FrameChanges, FrameElided;
+  unsigned long TotalChanges, TotalElided;
+
+  StateCache();
+  bool change(const bool needed);
+
+public:
+  StateCache(StateCache const &) = delete;
+  void operator=(StateCache const &) = delete;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
+
+#endif /* MGL_STATE_HPP */
@@ -0,0 +1,94 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Persistent-Mapped Stream Buffer (OpenGL 4.4)
+//
+// Copyright (c)2022-25 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "./mglStreamBuffer.hpp"
+#include "./mglState.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+namespace mgl {
+
+/////////////////////////////////////////////////////////////////// StreamBuffer
+
+// Regions start on a boundary valid for any buffer binding offset.
+static const GLsizeiptr REGION_ALIGNMENT = 256;
+
+StreamBuffer::StreamBuffer(const GLsizeiptr region_size)
+    : BufferId(0),
+      RegionSize((region_size + REGION_ALIGNMENT - 1) / REGION_ALIGNMENT *
+                 REGION_ALIGNMENT),
+      Data(nullptr), Fences{}, Region(REGIONS - 1), MapCount(0),
+      FenceWaits(0), FenceWaitTime(0.0) {
+  const GLbitfield flags =
+      GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  const GLsizeiptr size = RegionSize * REGIONS;
+
+  glGenBuffers(1, &BufferId);
+  StateCache::getInstance().bindBuffer(GL_COPY_WRITE_BUFFER, BufferId);
+  glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags);
+  Data = static_cast<unsigned char *>(
+      glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags));
+  if (!Data) {
+    std::cerr << "[ERROR] Failed to map stream buffer of " << size
+              << " bytes" << std::endl;
+    throw std::runtime_error("Failed to map stream buffer.");
+  }
+}
+
+StreamBuffer::~StreamBuffer() {
+  for (GLsync &fence : Fences) {
+    if (fence) {
+      glDeleteSync(fence);
+    }
+  }
+  // Deleting a buffer unmaps it
+  StateCache::getInstance().forgetBuffer(BufferId);
+  glDeleteBuffers(1, &BufferId);
+}
+
+void StreamBuffer::waitFence(const int region) {
+  GLsync &fence = Fences[region];
+  if (!fence) {
+    return;
+  }
+  GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+  if (status == GL_TIMEOUT_EXPIRED) {
+    FenceWaits++;
+    const auto start = std::chrono::steady_clock::now();
+    do {
+      status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+    } while (status == GL_TIMEOUT_EXPIRED);
+    FenceWaitTime += std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+  }
+  if (status == GL_WAIT_FAILED) {
+    std::cerr << "[WARNING] Stream buffer fence wait failed" << std::endl;
+  }
+  glDeleteSync(fence);
+  fence = nullptr;
+}
+
+void *StreamBuffer::map() {
+  Region = (Region + 1) % REGIONS;
+  waitFence(Region);
+  MapCount++;
+  return Data + getOffset();
+}
+
+void StreamBuffer::fence() {
+  if (Fences[Region]) {
+    glDeleteSync(Fences[Region]);
+  }
+  Fences[Region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
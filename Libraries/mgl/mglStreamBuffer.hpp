@@ -0,0 +1,73 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Persistent-Mapped Stream Buffer (OpenGL 4.4)
+//
+// Copyright (c)2022-25 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MGL_STREAM_BUFFER_HPP
+#define MGL_STREAM_BUFFER_HPP
+
+#include <GL/glew.h>
+
+namespace mgl {
+
+class StreamBuffer;
+
+/////////////////////////////////////////////////////////////////// StreamBuffer
+
+// Buffer for data rewritten every frame. The storage is allocated once with
+// glBufferStorage and stays mapped (persistent, coherent) for the lifetime of
+// the buffer. It is split into REGIONS regions used in turn: the application
+// writes the next region while the GPU may still read the previous ones, and a
+// fence placed after the last draw reading a region guards it from being
+// written again too early.
+//
+//   void *data = buffer.map();     // waits for the region if still in use
+//   ... write, then bind buffer.BufferId at buffer.getOffset() and draw ...
+//   buffer.fence();                // after the draws reading the region
+
+class StreamBuffer final {
+public:
+  static const int REGIONS = 3;
+  GLuint BufferId;
+
+  explicit StreamBuffer(const GLsizeiptr region_size);
+  ~StreamBuffer();
+
+  StreamBuffer(const StreamBuffer &) = delete;
+  StreamBuffer &operator=(const StreamBuffer &) = delete;
+
+  // Moves to the next region and returns a pointer to it, blocking until the
+  // GPU is done with it.
+  void *map();
+  // Fences the draws issued so far, which read the current region. May be
+  // called every frame while the region stays current.
+  void fence();
+
+  GLintptr getOffset() const { return Region * RegionSize; }
+  GLsizeiptr getRegionSize() const { return RegionSize; }
+
+  // Number of map() calls that found their region still in use, and the
+  // total time spent blocked on them.
+  unsigned long getMapCount() const { return MapCount; }
+  unsigned long getFenceWaits() const { return FenceWaits; }
+  double getFenceWaitTime() const { return FenceWaitTime; }
+
+private:
+  GLsizeiptr RegionSize;
+  unsigned char *Data;
+  GLsync Fences[REGIONS];
+  int Region;
+  unsigned long MapCount;
+  unsigned long FenceWaits;
+  double FenceWaitTime;
+
+  void waitFence(const int region);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
+
+#endif /* MGL_STREAM_BUFFER_HPP */
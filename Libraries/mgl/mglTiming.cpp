@@ -0,0 +1,151 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Frame Timing Histograms
+//
+// Copyright (c)2022-25 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include "./mglTiming.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace mgl {
+
+////////////////////////////////////////////////////////////////// TimeHistogram
+
+TimeHistogram::TimeHistogram() { clear(); }
+
+void TimeHistogram::clear() {
+  Buckets.fill(0);
+  Count = 0;
+  Sum = 0.0;
+  Max = 0.0;
+}
+
+int TimeHistogram::bucket(const std::uint64_t ns) {
+  // ns >> shift keeps the SUB_BITS bits below the leading one
+  int shift = 0;
+  while ((ns >> shift) >= 2 * SUB_BUCKETS && shift < MAX_SHIFT) {
+    shift++;
+  }
+  const std::uint64_t value =
+      std::min<std::uint64_t>(ns >> shift, 2 * SUB_BUCKETS - 1);
+  return shift * SUB_BUCKETS + static_cast<int>(value);
+}
+
+std::uint64_t TimeHistogram::upperBound(const int bucket) {
+  const int shift = bucket < 2 * SUB_BUCKETS ? 0 : bucket / SUB_BUCKETS - 1;
+  const std::uint64_t value = bucket - shift * SUB_BUCKETS;
+  return (value + 1) << shift;
+}
+
+void TimeHistogram::record(const double seconds) {
+  const double ns = std::max(seconds, 0.0) * 1e9;
+  Buckets[bucket(static_cast<std::uint64_t>(ns))]++;
+  Count++;
+  Sum += seconds;
+  Max = std::max(Max, seconds);
+}
+
+double TimeHistogram::getPercentile(const double fraction) const {
+  if (Count == 0) {
+    return 0.0;
+  }
+  const unsigned long rank = std::max<unsigned long>(
+      1, static_cast<unsigned long>(fraction * Count + 0.5));
+  unsigned long seen = 0;
+  for (int i = 0; i < BUCKETS; i++) {
+    seen += Buckets[i];
+    if (seen >= rank) {
+      return std::min(upperBound(i) * 1e-9, Max);
+    }
+  }
+  return Max;
+}
+
+void writeTimingHeader(std::ostream &out, const std::string &title) {
+  out << title << ", in ms" << std::endl
+      << "                  p50      p90      p99      max" << std::endl;
+}
+
+void writeTimingRow(std::ostream &out, const std::string &name,
+                    const TimeHistogram &histogram) {
+  std::ostringstream row;
+  row << std::fixed << std::setprecision(3) << "  " << std::left
+      << std::setw(12) << name << std::right;
+  for (const double fraction : {0.5, 0.9, 0.99}) {
+    row << std::setw(9) << histogram.getPercentile(fraction) * 1000.0;
+  }
+  row << std::setw(9) << histogram.getMax() * 1000.0;
+  out << row.str() << std::endl;
+}
+
+///////////////////////////////////////////////////////////////////// FrameTimer
+
+// Frames before spikes are looked for, while the average settles.
+static const unsigned long WARMUP_FRAMES = 30;
+
+FrameTimer::FrameTimer()
+    : Average(0.0), SpikeFactor(2.0), SpikeCount(0), Spikes{} {}
+
+void FrameTimer::clear() {
+  for (TimeHistogram &phase : Phases) {
+    phase.clear();
+  }
+  Total.clear();
+  Average = 0.0;
+  SpikeCount = 0;
+}
+
+void FrameTimer::addFrame(const unsigned long frame,
+                          const double (&phases)[PHASES]) {
+  double total = 0.0;
+  for (int i = 0; i < PHASES; i++) {
+    Phases[i].record(phases[i]);
+    total += phases[i];
+  }
+  if (Total.getCount() >= WARMUP_FRAMES && total > SpikeFactor * Average) {
+    Spike &spike = Spikes[SpikeCount % SPIKES];
+    spike.frame = frame;
+    spike.total = total;
+    std::copy(phases, phases + PHASES, spike.phases);
+    SpikeCount++;
+  }
+  // About the last 16 frames, so that a spike barely moves it
+  Average = Total.getCount() == 0 ? total : Average + (total - Average) / 16.0;
+  Total.record(total);
+}
+
+void FrameTimer::report(std::ostream &out) const {
+  static const char *const NAMES[PHASES] = {"poll", "update", "display",
+                                            "swap"};
+  // Formatted apart, so that the flags of out are left alone
+  std::ostringstream text;
+  writeTimingHeader(text, "Frame timing over " +
+                              std::to_string(Total.getCount()) + " frames");
+  for (int i = 0; i < PHASES; i++) {
+    writeTimingRow(text, NAMES[i], Phases[i]);
+  }
+  writeTimingRow(text, "frame", Total);
+
+  text << std::fixed << SpikeCount << " spikes over " << std::setprecision(1)
+       << SpikeFactor << "x the recent average" << std::setprecision(3);
+  const unsigned long kept = std::min<unsigned long>(SpikeCount, SPIKES);
+  for (unsigned long i = SpikeCount - kept; i < SpikeCount; i++) {
+    const Spike &spike = Spikes[i % SPIKES];
+    text << std::endl
+         << "  frame " << spike.frame << ": " << spike.total * 1000.0 << " (";
+    for (int phase = 0; phase < PHASES; phase++) {
+      text << (phase > 0 ? ", " : "") << NAMES[phase] << " "
+           << spike.phases[phase] * 1000.0;
+    }
+    text << ")";
+  }
+  out << text.str() << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
@@ -0,0 +1,110 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Frame Timing Histograms
+//
+// Copyright (c)2022-25 by Carlos Martinho
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MGL_TIMING_HPP
+#define MGL_TIMING_HPP
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace mgl {
+
+class TimeHistogram;
+class FrameTimer;
+
+////////////////////////////////////////////////////////////////// TimeHistogram
+
+// Histogram of durations in log-linear buckets: every power of two of
+// nanoseconds is split into SUB_BUCKETS buckets of equal width, so that a
+// percentile is within 1/SUB_BUCKETS of the true value, from 1 ns up to about
+// two minutes. Longer durations go to the last bucket. Recording a sample is a
+// few integer operations on a fixed array.
+
+class TimeHistogram final {
+public:
+  static const int SUB_BITS = 4;
+  static const int SUB_BUCKETS = 1 << SUB_BITS;
+  static const int MAX_SHIFT = 32; // The last buckets are 2^32 ns wide
+  static const int BUCKETS = (MAX_SHIFT + 2) * SUB_BUCKETS;
+
+  TimeHistogram();
+
+  void record(const double seconds);
+  void clear();
+
+  unsigned long getCount() const { return Count; }
+  double getMean() const { return Count > 0 ? Sum / Count : 0.0; }
+  double getMax() const { return Max; }
+  // Upper bound of the bucket holding the sample below which the given
+  // fraction of the samples fall, e.g. 0.99 for p99, at most the maximum.
+  double getPercentile(const double fraction) const;
+
+private:
+  std::array<std::uint32_t, BUCKETS> Buckets;
+  unsigned long Count;
+  double Sum;
+  double Max;
+
+  static int bucket(const std::uint64_t ns);
+  static std::uint64_t upperBound(const int bucket);
+};
+
+// Rows of the timing reports: a name then p50, p90, p99 and max in ms.
+void writeTimingHeader(std::ostream &out, const std::string &title);
+void writeTimingRow(std::ostream &out, const std::string &name,
+                    const TimeHistogram &histogram);
+
+///////////////////////////////////////////////////////////////////// FrameTimer
+
+// Where the time of each frame of the Engine goes: event polling, the update
+// and display callbacks of the App, and the buffer swap, which includes
+// waiting for vsync.
+// Frames that take more than SpikeFactor times the recent average are spikes,
+// e.g. a shader compile or a page fault, and the last SPIKES of them are kept
+// along with the time of each phase.
+
+class FrameTimer final {
+public:
+  enum Phase { POLL, UPDATE, DISPLAY, SWAP, PHASES };
+  static const int SPIKES = 8;
+
+  struct Spike {
+    unsigned long frame;
+    double total;
+    double phases[PHASES];
+  };
+
+  FrameTimer();
+
+  void addFrame(const unsigned long frame, const double (&phases)[PHASES]);
+  void clear();
+  void setSpikeFactor(const double factor) { SpikeFactor = factor; }
+
+  const TimeHistogram &getPhase(const Phase phase) const {
+    return Phases[phase];
+  }
+  const TimeHistogram &getTotal() const { return Total; }
+  unsigned long getSpikeCount() const { return SpikeCount; }
+  // Percentiles of every phase and of whole frames, then the last spikes.
+  void report(std::ostream &out) const;
+
+private:
+  std::array<TimeHistogram, PHASES> Phases;
+  TimeHistogram Total;
+  double Average; // Moving average of the frame time
+  double SpikeFactor;
+  unsigned long SpikeCount;
+  std::array<Spike, SPIKES> Spikes; // Ring, the last SpikeCount % SPIKES
+};
+
+////////////////////////////////////////////////////////////////////////////////
+} // namespace mgl
+
+#endif /* MGL_TIMING_HPP */
@@ -0,0 +1,208 @@
+#include "PieceRenderer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+
+PieceRenderer::PieceRenderer(GeometryBuffer& geometry)
+    : geometry(geometry), matrices_block(PIECE_MATRICES_BINDING), colors_block(PIECE_COLORS_BINDING),
+      instance_count(0), indirect_buffer(0), command_capacity(0), capacity(0), storage_alignment(1), colors_offset(0),
+      uploaded_revision(0), uploaded_rebuild(0), uploaded(false), upload_count(0), submit_count(0),
+      fence_waits(0), fence_wait_time(0.0) {
+    GLint alignment = 1;
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    storage_alignment = static_cast<std::size_t>(std::max(alignment, 1));
+    glGenBuffers(1, &indirect_buffer);
+}
+
+PieceRenderer::~PieceRenderer() { destroy(); }
+
+void PieceRenderer::reserve(std::size_t pieces) {
+    // The first upload allocates, even of an empty table
+    if (instances && pieces <= capacity) {
+        return;
+    }
+    // Only growing allocates, the stream buffer is reused from frame to frame
+    if (instances) {
+        fence_waits += instances->getFenceWaits();
+        fence_wait_time += instances->getFenceWaitTime();
+    }
+    capacity = std::max<std::size_t>(capacity * 2, std::max<std::size_t>(pieces, 64));
+    colors_offset = (capacity * sizeof(glm::mat4) + storage_alignment - 1) / storage_alignment * storage_alignment;
+    instances = std::make_unique<mgl::StreamBuffer>(colors_offset + capacity * sizeof(glm::vec4));
+}
+
+unsigned char* PieceRenderer::beginUpload(const PieceTable& pieces, const TransformCache& transforms) {
+    const bool table_changed = !uploaded || pieces.getRevision() != uploaded_revision;
+    const bool matrices_changed = table_changed || transforms.getRebuildCount() != uploaded_rebuild;
+    if (!matrices_changed) {
+        return nullptr;
+    }
+    if (!pieces.isSortedByMesh()) {
+        throw std::invalid_argument("Pieces must be sorted by mesh");
+    }
+    if (pieces.getMeshLimit() > geometry.getMeshCount()) {
+        throw std::invalid_argument("Pieces of a mesh the geometry does not have");
+    }
+    // Written before any draw is recorded, as those cover every command
+    if (table_changed) {
+        updateCommands(pieces);
+    }
+    // The other regions are out of date, so the whole instance data is written
+    reserve(pieces.size());
+    instance_count = pieces.size();
+    return static_cast<unsigned char*>(instances->map());
+}
+
+void PieceRenderer::updateCommands(const PieceTable& pieces) {
+    // Meshes added to the geometry since the last update get a command, and the
+    // buffer only grows
+    for (std::size_t mesh = commands.size(); mesh < geometry.getMeshCount(); mesh++) {
+        const MeshRange& range = geometry.getMesh(static_cast<int>(mesh));
+        commands.push_back({range.index_count, 0, range.first_index, range.base_vertex, 0});
+    }
+    std::size_t first = 0;
+    for (std::size_t mesh = 0; mesh < commands.size(); mesh++) {
+        const std::size_t count = pieces.getMeshCount(static_cast<int>(mesh));
+        commands[mesh].instance_count = static_cast<GLuint>(count);
+        commands[mesh].base_instance = static_cast<GLuint>(first);
+        first += count;
+    }
+    mgl::StateCache::getInstance().bindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer);
+    const GLsizeiptr size = static_cast<GLsizeiptr>(commands.size() * sizeof(DrawElementsIndirectCommand));
+    if (commands.size() > command_capacity) {
+        command_capacity = std::max(commands.size(), command_capacity * 2);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, command_capacity * sizeof(DrawElementsIndirectCommand), nullptr,
+            GL_DYNAMIC_DRAW);
+    }
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, size, commands.data());
+}
+
+void PieceRenderer::endUpload(const PieceTable& pieces, const TransformCache& transforms) {
+    uploaded_revision = pieces.getRevision();
+    uploaded_rebuild = transforms.getRebuildCount();
+    uploaded = true;
+    upload_count++;
+}
+
+void PieceRenderer::update(const PieceTable& pieces, const TransformCache& transforms) {
+    unsigned char* region = beginUpload(pieces, transforms);
+    if (!region) {
+        return;
+    }
+    std::memcpy(region, pieces.getMatrices(), pieces.size() * sizeof(glm::mat4));
+    std::memcpy(region + colors_offset, pieces.getColors(), pieces.size() * sizeof(glm::vec4));
+    endUpload(pieces, transforms);
+}
+
+void PieceRenderer::check(mgl::ShaderProgram& program) const {
+    matrices_block.check(program, PIECE_MATRICES_BLOCK);
+    colors_block.check(program, PIECE_COLORS_BLOCK);
+}
+
+void PieceRenderer::bindBlocks(void* renderer) {
+    // Block bindings are context state, not VAO state, so they are set when the draw is issued
+    PieceRenderer& self = *static_cast<PieceRenderer*>(renderer);
+    const mgl::StreamBuffer& instances = *self.instances;
+    self.matrices_block.bind(instances.BufferId, instances.getOffset(), self.instance_count);
+    self.colors_block.bind(instances.BufferId, instances.getOffset() + self.colors_offset, self.instance_count);
+}
+
+std::size_t PieceRenderer::indirectDraw(std::size_t first, mgl::DrawItem& item) const {
+    // One indirect draw per run of meshes sharing an index type
+    const GLenum index_type = geometry.getMesh(static_cast<int>(first)).index_type;
+    std::size_t last = first + 1;
+    while (last < commands.size() && geometry.getMesh(static_cast<int>(last)).index_type == index_type) {
+        last++;
+    }
+    item.index_type = index_type;
+    item.indirect_offset = static_cast<GLintptr>(first * sizeof(DrawElementsIndirectCommand));
+    item.draw_count = static_cast<GLsizei>(last - first);
+    return last;
+}
+
+void PieceRenderer::submit(mgl::RenderQueue& queue, const mgl::ShaderProgram& program, std::uint8_t layer) {
+    if (!uploaded || instance_count == 0) {
+        return;
+    }
+    mgl::DrawItem item = {};
+    item.program = program.ProgramId;
+    item.vao = geometry.getVao();
+    item.mode = GL_TRIANGLES;
+    item.indirect = indirect_buffer;
+    item.setup = bindBlocks;
+    item.setup_data = this;
+    for (std::size_t first = 0; first < commands.size();) {
+        first = indirectDraw(first, item);
+        queue.submit(layer, item);
+    }
+    submit_count++;
+}
+
+void PieceRenderer::record(mgl::CommandRecorder& recorder, const PieceTable& pieces,
+    const TransformCache& transforms, const mgl::ShaderProgram& program, std::uint8_t layer) {
+    // Mapping may wait on a fence, so it is done before the workers start
+    unsigned char* region = beginUpload(pieces, transforms);
+    mgl::DrawItem item = {};
+    item.program = program.ProgramId;
+    item.vao = geometry.getVao();
+    item.mode = GL_TRIANGLES;
+    item.indirect = indirect_buffer;
+    item.setup = bindBlocks;
+    item.setup_data = this;
+
+    recorder.record(pieces.size(), [&](std::size_t begin, std::size_t end, mgl::CommandList& list) {
+        if (region) {
+            std::memcpy(region + begin * sizeof(glm::mat4), pieces.getMatrices() + begin,
+                (end - begin) * sizeof(glm::mat4));
+            std::memcpy(region + colors_offset + begin * sizeof(glm::vec4), pieces.getColors() + begin,
+                (end - begin) * sizeof(glm::vec4));
+        }
+        // The indirect draws cover every range, so only the first one records them
+        if (begin == 0) {
+            mgl::DrawItem draw = item;
+            for (std::size_t first = 0; first < commands.size();) {
+                first = indirectDraw(first, draw);
+                list.record(layer, draw);
+            }
+        }
+    });
+
+    // The upload only counts once the workers wrote the whole region
+    if (region) {
+        endUpload(pieces, transforms);
+    }
+    submit_count++;
+}
+
+void PieceRenderer::fence() {
+    if (instances) {
+        instances->fence();
+    }
+}
+
+void PieceRenderer::destroy() {
+    if (indirect_buffer != 0) {
+        if (instances) {
+            fence_waits += instances->getFenceWaits();
+            fence_wait_time += instances->getFenceWaitTime();
+        }
+        instances.reset();
+        mgl::StateCache::getInstance().forgetBuffer(indirect_buffer);
+        glDeleteBuffers(1, &indirect_buffer);
+        indirect_buffer = 0;
+        commands.clear();
+        command_capacity = 0;
+        capacity = 0;
+        uploaded = false;
+    }
+}
+
+unsigned long PieceRenderer::getFenceWaits() const {
+    return fence_waits + (instances ? instances->getFenceWaits() : 0);
+}
+
+double PieceRenderer::getFenceWaitTime() const {
+    return fence_wait_time + (instances ? instances->getFenceWaitTime() : 0.0);
+}
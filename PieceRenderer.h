@@ -0,0 +1,94 @@
+#pragma once
+
+#include "../mgl/mgl.hpp"
+#include "GeometryBuffer.h"
+#include "PieceTable.h"
+#include "TransformCache.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Shader storage blocks read by clip-vs.glsl, indexed by gl_BaseInstance + gl_InstanceID.
+const char PIECE_MATRICES_BLOCK[] = "PieceMatrices";
+const char PIECE_COLORS_BLOCK[] = "PieceColors";
+constexpr GLuint PIECE_MATRICES_BINDING = 0;
+constexpr GLuint PIECE_COLORS_BINDING = 1;
+
+// Draws every piece of a PieceTable with a single glMultiDrawElementsIndirect
+// per index type of the meshes, submitted to an mgl::RenderQueue.
+// The matrices and colors columns are copied as they are into a region of a
+// persistent-mapped mgl::StreamBuffer, [matrices | colors], and each column is
+// bound as the array of a shader storage block, the colors at an offset rounded
+// up to GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT. Since the table is sorted by
+// mesh, the pieces of a mesh are a contiguous range: the indirect buffer holds
+// one command per mesh whose base instance is the start of that range, so the
+// instance index is the PieceId. A new region is only written when the table
+// or its matrices changed; otherwise the last one is drawn again. Meshes added
+// to the geometry later get their command with the next change of the table.
+// record() is the multithreaded alternative to update() and submit(): each
+// worker of an mgl::CommandRecorder copies a range of pieces into the region,
+// and the same indirect draws are recorded along with the first range.
+class PieceRenderer {
+	private:
+		GeometryBuffer& geometry;
+		std::unique_ptr<mgl::StreamBuffer> instances;
+		mgl::StorageBlock<glm::mat4> matrices_block;
+		mgl::StorageBlock<glm::vec4> colors_block;
+		std::size_t instance_count;
+		GLuint indirect_buffer;
+		std::vector<DrawElementsIndirectCommand> commands; // One per mesh of the geometry
+		std::size_t command_capacity; // Of the indirect buffer
+		std::size_t capacity; // In pieces
+		std::size_t storage_alignment; // Of the offsets storage blocks are bound at
+		std::size_t colors_offset; // In the region, past the matrices
+		unsigned long uploaded_revision;
+		unsigned long uploaded_rebuild;
+		bool uploaded;
+
+		unsigned long upload_count;
+		unsigned long submit_count;
+		unsigned long fence_waits; // Of the stream buffers replaced by reserve()
+		double fence_wait_time;
+
+		void reserve(std::size_t pieces);
+		// Maps a new region if the table or its matrices changed, nullptr otherwise.
+		// The commands are updated first when the table changed.
+		unsigned char* beginUpload(const PieceTable& pieces, const TransformCache& transforms);
+		void endUpload(const PieceTable& pieces, const TransformCache& transforms);
+		// Writes the instance ranges of the pieces, with a command for every mesh
+		// of the geometry, including the ones added since the last call.
+		void updateCommands(const PieceTable& pieces);
+		// Sets the draw of the run of meshes starting at first that share an
+		// index type. Returns the end of the run.
+		std::size_t indirectDraw(std::size_t first, mgl::DrawItem& item) const;
+		static void bindBlocks(void* renderer);
+
+	public:
+		explicit PieceRenderer(GeometryBuffer& geometry);
+		~PieceRenderer();
+		PieceRenderer(const PieceRenderer&) = delete;
+		PieceRenderer& operator=(const PieceRenderer&) = delete;
+
+		// Copies the table into the instance buffer if it changed since the last
+		// call. The table must be sorted by mesh.
+		void update(const PieceTable& pieces, const TransformCache& transforms);
+		// Throws if the blocks of the program do not match the C++ types.
+		void check(mgl::ShaderProgram& program) const;
+		// Queues the draw of the pieces as of the last update().
+		void submit(mgl::RenderQueue& queue, const mgl::ShaderProgram& program, std::uint8_t layer = 0);
+		// Updates and records the draws of the pieces on the workers of the
+		// recorder. GL calls are only made on the calling thread.
+		void record(mgl::CommandRecorder& recorder, const PieceTable& pieces, const TransformCache& transforms,
+			const mgl::ShaderProgram& program, std::uint8_t layer = 0);
+		// Marks the end of the draws using the current region. Must be called
+		// once the queue holding them was flushed.
+		void fence();
+		void destroy();
+
+		unsigned long getUploadCount() const { return upload_count; }
+		unsigned long getSubmitCount() const { return submit_count; }
+		// Number of uploads that had to wait for the GPU to release their region.
+		unsigned long getFenceWaits() const;
+		double getFenceWaitTime() const;
+};
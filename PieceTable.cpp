@@ -0,0 +1,162 @@
+#include "PieceTable.h"
+
+#include <algorithm>
+
+
+template <typename T>
+static AlignedArray<T> allocateColumn(std::size_t size) {
+    void* ptr = ::operator new(sizeof(T) * size, std::align_val_t(PIECE_TABLE_ALIGNMENT));
+    return AlignedArray<T>(static_cast<T*>(ptr));
+}
+
+template <typename T>
+static void growColumn(AlignedArray<T>& column, std::size_t count, std::size_t new_capacity) {
+    AlignedArray<T> grown = allocateColumn<T>(new_capacity);
+    if (column) {
+        std::copy(column.get(), column.get() + count, grown.get());
+    }
+    column = std::move(grown);
+}
+
+PieceTable::PieceTable(std::size_t capacity) : count(0), capacity(0), sorted(true), dirty(true), revision(0) {
+    reserve(std::max<std::size_t>(capacity, 1));
+}
+
+void PieceTable::reserve(std::size_t new_capacity) {
+    if (new_capacity <= capacity) {
+        return;
+    }
+    growColumn(position_x, count, new_capacity);
+    growColumn(position_y, count, new_capacity);
+    growColumn(rotations, count, new_capacity);
+    growColumn(scales, count, new_capacity);
+    growColumn(colors, count, new_capacity);
+    growColumn(meshes, count, new_capacity);
+    growColumn(matrices, count, new_capacity);
+    growColumn(changed, count, new_capacity);
+    capacity = new_capacity;
+}
+
+PieceId PieceTable::add(int mesh, const glm::vec2& position, float rotation, float scale, const glm::vec4& color) {
+    if (mesh < 0) {
+        throw std::invalid_argument("Invalid shape type");
+    }
+    if (count == capacity) {
+        reserve(capacity * 2);
+    }
+    if (count > 0 && static_cast<std::uint32_t>(mesh) < meshes[count - 1]) {
+        sorted = false;
+    }
+    const std::size_t row = count++;
+    position_x[row] = position.x;
+    position_y[row] = position.y;
+    rotations[row] = rotation;
+    scales[row] = scale;
+    colors[row] = color;
+    meshes[row] = static_cast<std::uint32_t>(mesh);
+    matrices[row] = glm::mat4(1.0f);
+    changed[row] = 1;
+    if (static_cast<std::size_t>(mesh) >= mesh_count.size()) {
+        mesh_count.resize(mesh + 1, 0);
+    }
+    mesh_count[mesh]++;
+    dirty = true;
+    revision++;
+    return static_cast<PieceId>(row);
+}
+
+void PieceTable::clear() {
+    count = 0;
+    mesh_count.clear(); // Keeps its capacity
+    sorted = true;
+    dirty = true;
+    revision++;
+}
+
+std::size_t PieceTable::getMeshFirst(int mesh) const {
+    std::size_t first = 0;
+    const int end = std::min(mesh, static_cast<int>(mesh_count.size()));
+    for (int i = 0; i < end; i++) {
+        first += mesh_count[i];
+    }
+    return first;
+}
+
+void PieceTable::sortByMesh() {
+    if (sorted) {
+        return;
+    }
+    // Counting sort, linear in the number of pieces and meshes
+    std::vector<std::size_t> next(mesh_count.size());
+    std::size_t first = 0;
+    for (std::size_t mesh = 0; mesh < mesh_count.size(); mesh++) {
+        next[mesh] = first;
+        first += mesh_count[mesh];
+    }
+
+    PieceTable reordered(capacity);
+    for (std::size_t row = 0; row < count; row++) {
+        const std::size_t dst = next[meshes[row]]++;
+        reordered.position_x[dst] = position_x[row];
+        reordered.position_y[dst] = position_y[row];
+        reordered.rotations[dst] = rotations[row];
+        reordered.scales[dst] = scales[row];
+        reordered.colors[dst] = colors[row];
+        reordered.meshes[dst] = meshes[row];
+        reordered.matrices[dst] = matrices[row];
+        reordered.changed[dst] = 1;
+    }
+    position_x = std::move(reordered.position_x);
+    position_y = std::move(reordered.position_y);
+    rotations = std::move(reordered.rotations);
+    scales = std::move(reordered.scales);
+    colors = std::move(reordered.colors);
+    meshes = std::move(reordered.meshes);
+    matrices = std::move(reordered.matrices);
+    changed = std::move(reordered.changed);
+    sorted = true;
+    dirty = true;
+    revision++;
+}
+
+void PieceTable::clearDirty() {
+    if (dirty) {
+        std::fill(changed.get(), changed.get() + count, 0);
+        dirty = false;
+    }
+}
+
+void PieceTable::setPosition(PieceId id, const glm::vec2& position) {
+    if (position.x != position_x[id] || position.y != position_y[id]) {
+        position_x[id] = position.x;
+        position_y[id] = position.y;
+        changed[id] = 1;
+        dirty = true;
+        revision++;
+    }
+}
+
+void PieceTable::setRotation(PieceId id, float rotation) {
+    if (rotation != rotations[id]) {
+        rotations[id] = rotation;
+        changed[id] = 1;
+        dirty = true;
+        revision++;
+    }
+}
+
+void PieceTable::setScale(PieceId id, float scale) {
+    if (scale != scales[id]) {
+        scales[id] = scale;
+        changed[id] = 1;
+        dirty = true;
+        revision++;
+    }
+}
+
+void PieceTable::setColor(PieceId id, const glm::vec4& color) {
+    if (color != colors[id]) {
+        colors[id] = color;
+        revision++;
+    }
+}
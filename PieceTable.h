@@ -0,0 +1,94 @@
+#pragma once
+
+#include "../mgl/mgl.hpp"
+#include "Shape2D.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+typedef std::uint32_t PieceId;
+
+// Columns are aligned for SIMD loads and so that no two columns share a cache line.
+constexpr std::size_t PIECE_TABLE_ALIGNMENT = 64;
+
+struct AlignedDelete {
+	void operator()(void* ptr) const {
+		::operator delete(ptr, std::align_val_t(PIECE_TABLE_ALIGNMENT));
+	}
+};
+
+template <typename T>
+using AlignedArray = std::unique_ptr<T[], AlignedDelete>;
+
+// Structure of arrays holding every tangram piece. A piece is addressed by its
+// PieceId, which is the row it occupies. Positions, rotations and scales are
+// expressed in figure space at unit scale; the matrices column is written by
+// the TransformCache.
+class PieceTable {
+	private:
+		std::size_t count, capacity;
+		AlignedArray<float> position_x, position_y;
+		AlignedArray<float> rotations; // Degrees around the z axis
+		AlignedArray<float> scales;
+		AlignedArray<glm::vec4> colors;
+		AlignedArray<std::uint32_t> meshes;
+		AlignedArray<glm::mat4> matrices;
+		AlignedArray<std::uint8_t> changed;
+		std::vector<std::size_t> mesh_count; // Up to the highest mesh since clear()
+		bool sorted;
+		bool dirty;
+		unsigned long revision;
+
+		void reserve(std::size_t new_capacity);
+
+	public:
+		explicit PieceTable(std::size_t capacity = 16);
+
+		PieceId add(int mesh, const glm::vec2& position, float rotation, float scale, const glm::vec4& color);
+		void clear();
+		// Stable reorder of the rows so that pieces sharing a mesh are contiguous.
+		// Renumbers the PieceIds.
+		void sortByMesh();
+
+		std::size_t size() const { return count; }
+		// Rows of a mesh are contiguous while the table is sorted by mesh, which
+		// holds as long as pieces are added in mesh order.
+		bool isSortedByMesh() const { return sorted; }
+		std::size_t getMeshFirst(int mesh) const;
+		std::size_t getMeshCount(int mesh) const {
+			return static_cast<std::size_t>(mesh) < mesh_count.size() ? mesh_count[mesh] : 0;
+		}
+		// One past the highest mesh of the pieces added since the last clear().
+		std::size_t getMeshLimit() const { return mesh_count.size(); }
+
+		// Set whenever a position, rotation or scale changes, per piece and for the whole table.
+		bool isDirty() const { return dirty; }
+		bool isPieceDirty(PieceId id) const { return changed[id] != 0; }
+		void clearDirty();
+		// Incremented by every change to the rows, colors included. The matrices
+		// column is not covered, see TransformCache::getRebuildCount().
+		unsigned long getRevision() const { return revision; }
+
+		void setPosition(PieceId id, const glm::vec2& position);
+		void setRotation(PieceId id, float rotation);
+		void setScale(PieceId id, float scale);
+		void setColor(PieceId id, const glm::vec4& color);
+
+		glm::vec2 getPosition(PieceId id) const { return glm::vec2(position_x[id], position_y[id]); }
+		float getRotation(PieceId id) const { return rotations[id]; }
+		float getScale(PieceId id) const { return scales[id]; }
+		const glm::vec4& getColor(PieceId id) const { return colors[id]; }
+		int getMesh(PieceId id) const { return meshes[id]; }
+		const glm::mat4& getMatrix(PieceId id) const { return matrices[id]; }
+
+		const float* getPositionsX() const { return position_x.get(); }
+		const float* getPositionsY() const { return position_y.get(); }
+		const float* getRotations() const { return rotations.get(); }
+		const float* getScales() const { return scales.get(); }
+		const glm::vec4* getColors() const { return colors.get(); }
+		const std::uint32_t* getMeshes() const { return meshes.get(); }
+		const glm::mat4* getMatrices() const { return matrices.get(); }
+		glm::mat4* getMatrices() { return matrices.get(); }
+};
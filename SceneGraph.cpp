@@ -0,0 +1,135 @@
+#include "SceneGraph.h"
+
+#include "Affine2D.h"
+#include <algorithm>
+#include <stdexcept>
+
+
+// first_dirty is past every node while the graph is clean
+static constexpr std::size_t CLEAN = static_cast<std::size_t>(-1);
+
+SceneGraph::SceneGraph() : first_dirty(CLEAN), last_update_count(0), total_update_count(0) {}
+
+NodeId SceneGraph::addNode(NodeId parent, const glm::vec2& position, float rotation, float scale,
+    const glm::mat4* world) {
+    const NodeId node = static_cast<NodeId>(size());
+    if (parent != NO_PARENT) {
+        if (parent >= node || subtree_ends[parent] != node) {
+            throw std::invalid_argument("Scene graph nodes must be added in depth-first order");
+        }
+        // The new node extends the subtree of its parent and of every ancestor
+        for (NodeId ancestor = parent; ancestor != NO_PARENT; ancestor = parents[ancestor]) {
+            subtree_ends[ancestor]++;
+        }
+    }
+    parents.push_back(parent);
+    subtree_ends.push_back(node + 1);
+    position_x.push_back(position.x);
+    position_y.push_back(position.y);
+    rotations.push_back(rotation);
+    scales.push_back(scale);
+    updated.push_back(0);
+    worlds.push_back(world ? *world : glm::mat4(1.0f));
+    dirty.push_back(0);
+    if (!world) {
+        markDirty(node);
+    }
+    return node;
+}
+
+void SceneGraph::clear() {
+    parents.clear();
+    subtree_ends.clear();
+    position_x.clear();
+    position_y.clear();
+    rotations.clear();
+    scales.clear();
+    worlds.clear();
+    dirty.clear();
+    updated.clear();
+    first_dirty = CLEAN;
+    last_update_count = 0;
+}
+
+void SceneGraph::markDirty(NodeId node) {
+    dirty[node] = 1;
+    first_dirty = std::min<std::size_t>(first_dirty, node);
+}
+
+void SceneGraph::setPosition(NodeId node, const glm::vec2& position) {
+    if (position.x != position_x[node] || position.y != position_y[node]) {
+        position_x[node] = position.x;
+        position_y[node] = position.y;
+        markDirty(node);
+    }
+}
+
+void SceneGraph::setRotation(NodeId node, float rotation) {
+    if (rotation != rotations[node]) {
+        rotations[node] = rotation;
+        markDirty(node);
+    }
+}
+
+void SceneGraph::setScale(NodeId node, float scale) {
+    if (scale != scales[node]) {
+        scales[node] = scale;
+        markDirty(node);
+    }
+}
+
+void SceneGraph::setLocal(NodeId node, const glm::vec2& position, float rotation, float scale) {
+    setPosition(node, position);
+    setRotation(node, rotation);
+    setScale(node, scale);
+}
+
+std::size_t SceneGraph::update(const ParallelFor& parallel_for) {
+    if (last_update_count > 0) {
+        std::fill(updated.begin(), updated.end(), 0);
+        last_update_count = 0;
+    }
+    if (!isDirty()) {
+        return 0;
+    }
+    static const glm::mat4 I(1.0f);
+    std::size_t count = 0;
+    // Nodes before recompute_end belong to a subtree whose root changed
+    std::size_t recompute_end = 0;
+    std::size_t node = first_dirty;
+    while (node < size()) {
+        if (!dirty[node] && node >= recompute_end) {
+            node++;
+            continue;
+        }
+        // Gather the run of consecutive siblings to recompute, only the last one
+        // can have children and those come after it.
+        const NodeId parent = parents[node];
+        std::size_t end = node;
+        while (end < size() && parents[end] == parent && (dirty[end] || end < recompute_end)) {
+            if (dirty[end]) {
+                recompute_end = std::max<std::size_t>(recompute_end, subtree_ends[end]);
+                dirty[end] = 0;
+            }
+            updated[end] = 1;
+            end++;
+        }
+        const glm::mat4& parent_world = parent == NO_PARENT ? I : worlds[parent];
+        if (parallel_for) {
+            parallel_for(end - node, [&](std::size_t begin, std::size_t last) {
+                composeAffine2D(parent_world, &position_x[node + begin], &position_y[node + begin],
+                    &rotations[node + begin], &scales[node + begin], last - begin, &worlds[node + begin]);
+            });
+        }
+        else {
+            composeAffine2D(parent_world, &position_x[node], &position_y[node], &rotations[node], &scales[node],
+                end - node, &worlds[node]);
+        }
+        count += end - node;
+        node = end;
+    }
+    first_dirty = CLEAN;
+    last_update_count = count;
+    total_update_count += count;
+    return count;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "../mgl/mgl.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+typedef std::uint32_t NodeId;
+constexpr NodeId NO_PARENT = 0xFFFFFFFF;
+
+// Runs body over [0, count), possibly split into ranges run concurrently, and
+// returns once every range is done (e.g. mgl::JobSystem::parallelFor).
+typedef std::function<void(std::size_t count, const std::function<void(std::size_t begin, std::size_t end)>& body)>
+	ParallelFor;
+
+// Hierarchy of 2D transformations (e.g. figure -> pieces). Nodes are stored in
+// flat arrays in depth-first order, so a parent always comes before its
+// children and a subtree is a contiguous range of nodes. Changing a node marks
+// its subtree dirty and update() recomputes only the dirty ranges in a single
+// linear pass, composing runs of siblings with the batched composeAffine2D().
+class SceneGraph {
+	private:
+		std::vector<NodeId> parents;
+		std::vector<NodeId> subtree_ends; // One past the last node of the subtree
+		std::vector<float> position_x, position_y;
+		std::vector<float> rotations; // Degrees around the z axis
+		std::vector<float> scales;
+		std::vector<glm::mat4> worlds;
+		std::vector<std::uint8_t> dirty;   // Local transformation changed
+		std::vector<std::uint8_t> updated; // World matrix recomputed by the last update()
+		std::size_t first_dirty;
+
+		std::size_t last_update_count;
+		unsigned long total_update_count;
+
+		void markDirty(NodeId node);
+
+	public:
+		SceneGraph();
+
+		// Nodes are appended in depth-first order: the parent must be the last
+		// node added or one of its ancestors. A node given its world matrix is
+		// added clean, e.g. when the matrices were precomputed.
+		NodeId addNode(NodeId parent, const glm::vec2& position, float rotation, float scale,
+			const glm::mat4* world = nullptr);
+		void clear();
+
+		std::size_t size() const { return parents.size(); }
+		NodeId getParent(NodeId node) const { return parents[node]; }
+		NodeId getSubtreeEnd(NodeId node) const { return subtree_ends[node]; }
+
+		void setPosition(NodeId node, const glm::vec2& position);
+		void setRotation(NodeId node, float rotation);
+		void setScale(NodeId node, float scale);
+		void setLocal(NodeId node, const glm::vec2& position, float rotation, float scale);
+
+		glm::vec2 getPosition(NodeId node) const { return glm::vec2(position_x[node], position_y[node]); }
+		float getRotation(NodeId node) const { return rotations[node]; }
+		float getScale(NodeId node) const { return scales[node]; }
+		const glm::mat4& getWorld(NodeId node) const { return worlds[node]; }
+
+		// Recomputes the world matrices of every dirty subtree. Returns the number of nodes recomputed.
+		// Runs of siblings are composed through parallel_for if given, since they only read their parent.
+		std::size_t update(const ParallelFor& parallel_for = nullptr);
+		bool isDirty() const { return first_dirty < size(); }
+		bool wasUpdated(NodeId node) const { return updated[node] != 0; }
+
+		std::size_t getLastUpdateCount() const { return last_update_count; }
+		unsigned long getTotalUpdateCount() const { return total_update_count; }
+};
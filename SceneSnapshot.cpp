@@ -0,0 +1,55 @@
+#include "SceneSnapshot.h"
+#include <algorithm>
+
+
+void takeSnapshot(const PieceTable& pieces, SceneSnapshot& snapshot) {
+    if (snapshot.valid && snapshot.revision == pieces.getRevision()) {
+        return;
+    }
+    snapshot.pieces.clear();
+    snapshot.matrices.clear();
+    for (PieceId id = 0; id < pieces.size(); id++) {
+        snapshot.pieces.push_back(
+            {pieces.getMesh(id), pieces.getPosition(id), pieces.getRotation(id), pieces.getScale(id),
+             pieces.getColor(id)});
+    }
+    if (!pieces.isDirty()) {
+        snapshot.matrices.assign(pieces.getMatrices(), pieces.getMatrices() + pieces.size());
+    }
+    snapshot.revision = pieces.getRevision();
+    snapshot.valid = true;
+}
+
+bool applySnapshot(const SceneSnapshot& snapshot, PieceTable& pieces, std::vector<std::uint8_t>& changed) {
+    bool same_meshes = snapshot.pieces.size() == pieces.size() && snapshot.matrices.empty();
+    for (PieceId id = 0; same_meshes && id < pieces.size(); id++) {
+        same_meshes = snapshot.pieces[id].mesh == pieces.getMesh(id);
+    }
+    if (same_meshes) {
+        changed.assign(pieces.size(), 0);
+        for (PieceId id = 0; id < pieces.size(); id++) {
+            const PieceRow& row = snapshot.pieces[id];
+            changed[id] = row.position != pieces.getPosition(id) || row.rotation != pieces.getRotation(id)
+                || row.scale != pieces.getScale(id) || row.color != pieces.getColor(id);
+            pieces.setPosition(id, row.position);
+            pieces.setRotation(id, row.rotation);
+            pieces.setScale(id, row.scale);
+            pieces.setColor(id, row.color);
+        }
+        return false;
+    }
+    pieces.clear();
+    for (const PieceRow& row : snapshot.pieces) {
+        pieces.add(row.mesh, row.position, row.rotation, row.scale, row.color);
+    }
+    // The matrices follow the order of the rows, so they are only valid if no
+    // sort is needed
+    const bool sorted = pieces.isSortedByMesh();
+    pieces.sortByMesh();
+    if (!snapshot.matrices.empty() && sorted) {
+        std::copy(snapshot.matrices.begin(), snapshot.matrices.end(), pieces.getMatrices());
+        pieces.clearDirty();
+    }
+    changed.assign(pieces.size(), 0);
+    return true;
+}
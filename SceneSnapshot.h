@@ -0,0 +1,38 @@
+#pragma once
+
+#include "../mgl/mgl.hpp"
+#include "PieceTable.h"
+#include <cstdint>
+#include <vector>
+
+struct PieceRow {
+	int mesh;
+	glm::vec2 position;
+	float rotation;
+	float scale;
+	glm::vec4 color;
+};
+
+// What drawing a frame needs of the scene, copied from the table the main
+// thread simulates to the one the render thread draws, through an
+// mgl::TripleBuffer. Rows are only copied again when the revision of the table
+// changed since the snapshot slot was last written.
+struct SceneSnapshot {
+	std::vector<PieceRow> pieces;
+	// Matrices of a table that has not changed since it was loaded, which then
+	// need not be recomputed. Empty otherwise.
+	std::vector<glm::mat4> matrices;
+	unsigned long revision = 0; // Of the table the rows were copied from
+	bool valid = false;
+	bool use_sdf = false;
+	float outline_width = 0.0f;
+};
+
+// Copies the rows of the table into the snapshot, unless it already holds them.
+void takeSnapshot(const PieceTable& pieces, SceneSnapshot& snapshot);
+// Brings the table to the rows of the snapshot, so that only the pieces that
+// moved are dirty, and sets changed[id] for the rows that differed, colors
+// included. Returns true if the table was refilled instead, with other meshes
+// or with the matrices of the snapshot: its TransformCache must then be
+// attached again, and no row is marked as changed.
+bool applySnapshot(const SceneSnapshot& snapshot, PieceTable& pieces, std::vector<std::uint8_t>& changed);
@@ -0,0 +1,64 @@
+#include "SdfPieces.h"
+
+
+static_assert(sizeof(SdfShapesBlock) == (SHAPE_COUNT * 4 + 1) * sizeof(glm::vec4), "SdfShapes is not std140");
+
+static SdfShapesBlock shapesBlock() {
+    SdfShapesBlock block = {};
+    const Vertex* shapes[SHAPE_COUNT] = {TRIANGLE_VERTICES, SQUARE_VERTICES, PARALLELOGRAM_VERTICES};
+    const int counts[SHAPE_COUNT] = {3, 4, 4};
+    for (int shape = 0; shape < SHAPE_COUNT; shape++) {
+        for (int i = 0; i < counts[shape]; i++) {
+            block.vertices[shape * 4 + i] = glm::vec4(shapes[shape][i].XYZW[0], shapes[shape][i].XYZW[1], 0.0f, 0.0f);
+        }
+        block.vertex_counts[shape] = static_cast<float>(counts[shape]);
+    }
+    return block;
+}
+
+static std::vector<MeshData> quadMeshes() {
+    std::vector<MeshData> meshes;
+    for (const std::array<Vertex, 4>& quad : SDF_QUADS) {
+        meshes.push_back({quad.data(), 4, SDF_QUAD_INDICES, 6});
+    }
+    return meshes;
+}
+
+SdfPieces::SdfPieces()
+    : geometry(quadMeshes()), shapes_block(SDF_SHAPES_BINDING), viewport_id(-1), outline_width_id(-1),
+      outline_color_id(-1), outline_width(0.0f), outline_color(0.0f, 0.0f, 0.0f, 1.0f) {
+    shapes_block.set(shapesBlock());
+}
+
+void SdfPieces::addTo(mgl::ShaderProgram& program) const {
+    program.addUniformBlock(SDF_SHAPES_BLOCK, SDF_SHAPES_BINDING);
+    program.addUniform(SDF_VIEWPORT_UNIFORM);
+    program.addUniform(SDF_OUTLINE_WIDTH_UNIFORM);
+    program.addUniform(SDF_OUTLINE_COLOR_UNIFORM);
+}
+
+void SdfPieces::check(mgl::ShaderProgram& program) {
+    shapes_block.check(program, SDF_SHAPES_BLOCK);
+    viewport_id = program.getUniformId(SDF_VIEWPORT_UNIFORM);
+    outline_width_id = program.getUniformId(SDF_OUTLINE_WIDTH_UNIFORM);
+    outline_color_id = program.getUniformId(SDF_OUTLINE_COLOR_UNIFORM);
+}
+
+void SdfPieces::setOutline(float width, const glm::vec4& color) {
+    outline_width = width;
+    outline_color = color;
+}
+
+void SdfPieces::bind(mgl::ShaderProgram& program, int width, int height) {
+    // Uploads are elided by the program while the values stay the same
+    program.set(viewport_id, glm::vec2(static_cast<float>(width), static_cast<float>(height)));
+    program.set(outline_width_id, outline_width);
+    program.set(outline_color_id, outline_color);
+    shapes_block.bind();
+    mgl::StateCache::getInstance().enable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+void SdfPieces::destroy() {
+    geometry.destroy();
+}
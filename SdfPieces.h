@@ -0,0 +1,76 @@
+#pragma once
+
+#include "../mgl/mgl.hpp"
+#include "GeometryBuffer.h"
+#include "Shape2D.h"
+#include <array>
+#include <cstddef>
+
+// Uniform block and uniforms read by sdf-vs.glsl and sdf-fs.glsl.
+const char SDF_SHAPES_BLOCK[] = "SdfShapes";
+constexpr GLuint SDF_SHAPES_BINDING = 0;
+const char SDF_VIEWPORT_UNIFORM[] = "Viewport";
+const char SDF_OUTLINE_WIDTH_UNIFORM[] = "OutlineWidth";
+const char SDF_OUTLINE_COLOR_UNIFORM[] = "OutlineColor";
+
+// Polygons of the shapes, four vertices per shape of which the first
+// vertex_counts[shape] are used, in the std140 layout of the SdfShapes block.
+struct SdfShapesBlock {
+	glm::vec4 vertices[SHAPE_COUNT * 4]; // xy
+	glm::vec4 vertex_counts;
+};
+
+// Bounding box of a shape as a quad whose vertices hold a corner in xy, the
+// shape in z and the corner in w, counterclockwise from the bottom left one.
+template <std::size_t N>
+constexpr std::array<Vertex, 4> boundingQuad(const Vertex (&vertices)[N], int shape) {
+	float x0 = vertices[0].XYZW[0], y0 = vertices[0].XYZW[1], x1 = x0, y1 = y0;
+	for (std::size_t i = 1; i < N; i++) {
+		x0 = vertices[i].XYZW[0] < x0 ? vertices[i].XYZW[0] : x0;
+		y0 = vertices[i].XYZW[1] < y0 ? vertices[i].XYZW[1] : y0;
+		x1 = vertices[i].XYZW[0] > x1 ? vertices[i].XYZW[0] : x1;
+		y1 = vertices[i].XYZW[1] > y1 ? vertices[i].XYZW[1] : y1;
+	}
+	const float z = static_cast<float>(shape);
+	return {{{{x0, y0, z, 0.0f}}, {{x1, y0, z, 1.0f}}, {{x1, y1, z, 2.0f}}, {{x0, y1, z, 3.0f}}}};
+}
+
+constexpr std::array<Vertex, 4> SDF_QUADS[SHAPE_COUNT] = {
+	boundingQuad(TRIANGLE_VERTICES, TRIANGLE),
+	boundingQuad(SQUARE_VERTICES, SQUARE),
+	boundingQuad(PARALLELOGRAM_VERTICES, PARALLELOGRAM)
+};
+constexpr GLubyte SDF_QUAD_INDICES[6] = { 0, 1, 2, 0, 2, 3 };
+
+// Resources of the signed distance field path, an alternative to drawing the
+// shape meshes with clip-fs.glsl. Given the geometry of this class, a
+// PieceRenderer draws every piece as its bounding quad, which sdf-vs.glsl
+// grows by the outline width plus one pixel. sdf-fs.glsl computes the distance
+// to the shape and turns it into the coverage of the pixel, antialiasing the
+// edges without multisampling, and draws the outline inside the edges in the
+// same pass. Coverage goes to alpha, so the pieces are blended.
+class SdfPieces {
+	private:
+		GeometryBuffer geometry;
+		mgl::UniformBlock<SdfShapesBlock> shapes_block;
+		mgl::UniformId viewport_id, outline_width_id, outline_color_id;
+		float outline_width; // In pixels, 0 for none
+		glm::vec4 outline_color;
+
+	public:
+		SdfPieces();
+		SdfPieces(const SdfPieces&) = delete;
+		SdfPieces& operator=(const SdfPieces&) = delete;
+
+		GeometryBuffer& getGeometry() { return geometry; }
+		// Declares the block and uniforms, before the program is created.
+		void addTo(mgl::ShaderProgram& program) const;
+		// Throws if the block of the created program does not match.
+		void check(mgl::ShaderProgram& program);
+
+		void setOutline(float width, const glm::vec4& color);
+		float getOutlineWidth() const { return outline_width; }
+		// Sets the uniforms of the program for a viewport and enables blending.
+		void bind(mgl::ShaderProgram& program, int width, int height);
+		void destroy();
+};
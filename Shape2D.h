@@ -1,37 +1,90 @@
 #pragma once
 
 #include "../mgl/mgl.hpp"
+#include "ConstexprMath.h"
+#include "VertexFormat.h"
+#include <cstddef>
 #include <memory>
 #include <stdexcept>
 
 constexpr auto TRIANGLE = 0;
 constexpr auto SQUARE = 1;
 constexpr auto PARALLELOGRAM = 2;
+constexpr auto SHAPE_COUNT = 3;
 
-typedef struct {
-	GLfloat XYZW[4];
-} Vertex;
+// Rectangular triangle with side length 1.0f, centered at the origin
+constexpr Vertex TRIANGLE_VERTICES[3] = {
+    {{-0.333333f, -0.333333f, 0.0f, 1.0f}},
+    {{ 0.666666f, -0.333333f, 0.0f, 1.0f}},
+    {{-0.333333f,  0.666666f, 0.0f, 1.0f}}
+};
+constexpr GLubyte TRIANGLE_INDICES[3] = { 0, 1, 2 };
+
+// Square with side length 1.0f, centered at the origin
+constexpr Vertex SQUARE_VERTICES[4] = {
+    {{-0.5f, -0.5f, 0.0f, 1.0f}},
+    {{ 0.5f, -0.5f, 0.0f, 1.0f}},
+    {{ 0.5f,  0.5f, 0.0f, 1.0f}},
+    {{-0.5f,  0.5f, 0.0f, 1.0f}}
+};
+constexpr GLubyte SQUARE_INDICES[6] = { 0, 1, 2, 0, 2, 3 };
+
+// Parallelogram with side length 1.0f and base length square root of 2, centered at the origin
+constexpr Vertex PARALLELOGRAM_VERTICES[4] = {
+    {{-0.353553f, -0.353553f, 0.0f, 1.0f}},
+    {{ 1.060660f, -0.353553f, 0.0f, 1.0f}},
+    {{ 0.353553f,  0.353553f, 0.0f, 1.0f}},
+    {{-1.060660f,  0.353553f, 0.0f, 1.0f}}
+};
+constexpr GLubyte PARALLELOGRAM_INDICES[6] = { 0, 1, 2, 0, 2, 3 };
 
+constexpr float edgeLength(const Vertex& a, const Vertex& b) {
+    return static_cast<float>(cx::sqrt(
+        (b.XYZW[0] - a.XYZW[0]) * (b.XYZW[0] - a.XYZW[0]) +
+        (b.XYZW[1] - a.XYZW[1]) * (b.XYZW[1] - a.XYZW[1])));
+}
+
+// Length of the side the tangram layout is built from: the legs of the
+// triangle, the side of the square and the short side of the parallelogram.
+constexpr float shapeSideLength(int shape) {
+    return shape == TRIANGLE ? edgeLength(TRIANGLE_VERTICES[0], TRIANGLE_VERTICES[1])
+        : shape == SQUARE ? edgeLength(SQUARE_VERTICES[0], SQUARE_VERTICES[1])
+        : edgeLength(PARALLELOGRAM_VERTICES[0], PARALLELOGRAM_VERTICES[3]);
+}
+
+// Area of the shape by the shoelace formula.
+template <std::size_t N>
+constexpr double shapeArea(const Vertex (&vertices)[N]) {
+    double area = 0.0;
+    for (std::size_t i = 0; i < N; i++) {
+        const Vertex& a = vertices[i];
+        const Vertex& b = vertices[(i + 1) % N];
+        area += static_cast<double>(a.XYZW[0]) * b.XYZW[1] - static_cast<double>(b.XYZW[0]) * a.XYZW[1];
+    }
+    return cx::abs(area) / 2;
+}
+
+// Vertices and indices of one of the tangram shapes, on the CPU only: the
+// meshes are drawn from the buffers of a GeometryBuffer they are added to.
 class Shape2D {
 	private:
-		Vertex* vertices;
+		const Vertex* vertices;
 		int vertex_count;
-		GLubyte* indices;
+		const GLubyte* indices;
 		int index_count;
-		GLuint vao, vbo[2];
 		int shapeType;
+		VertexFormat format;
 
-        const GLuint POSITION = 0, COLOR = 1;
-
-		void createShapeBuffers();
 		void triangle();
 		void square();
 		void parallelogram();
 
 	public:
-		Shape2D(int shape);
-        void draw();
-		void destroy();
+		Shape2D(int shape, VertexFormat format = VERTEX_FLOAT4);
 		float getSideLength();
-		GLuint get_vao() const { return vao; }
+		const Vertex* getVertices() const { return vertices; }
+		int getVertexCount() const { return vertex_count; }
+		const GLubyte* getIndices() const { return indices; }
+		int getIndexCount() const { return index_count; }
+		VertexFormat getVertexFormat() const { return format; }
 };
@@ -17,12 +17,28 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
 #include <memory>
+#include <string>
 #include <vector>
-#include <unordered_map>
 
 #include "../mgl/mgl.hpp"
+#include "FigureLibrary.h"
+#include "FigureTransition.h"
+#include "FillBenchmark.h"
+#include "GeometryBuffer.h"
+#include "PieceRenderer.h"
+#include "PieceTable.h"
+#include "SceneSnapshot.h"
+#include "SdfPieces.h"
 #include "Shape2D.h"
+#include "TransformCache.h"
 
 
 ////////////////////////////////////////////////////////////////////////// MYAPP
@@ -30,26 +46,74 @@
 class MyApp : public mgl::App {
 public:
   MyApp() = default;
+  MyApp(const std::string &library, bool sdf, bool benchmark,
+        const std::string &capture)
+      : LibraryFile(library), UseSdf(sdf), Benchmark(benchmark),
+        CaptureFile(capture) {}
   ~MyApp() override = default;
 
   void initCallback(GLFWwindow *win) override;
+  void updateCallback(GLFWwindow *win, double step) override;
+  void snapshotCallback(GLFWwindow *win) override;
   void displayCallback(GLFWwindow *win, double elapsed) override;
   void windowCloseCallback(GLFWwindow *win) override;
   void windowSizeCallback(GLFWwindow *win, int width, int height) override;
+  void keyCallback(GLFWwindow *win, int key, int scancode, int action,
+                   int mods) override;
 
 private:
-  const GLuint POSITION = 0, COLOR = 1;
-  GLuint VaoId, VboId[2];
+  const GLuint POSITION = GEOMETRY_POSITION;
+  // 4 bytes per vertex instead of 16
+  const VertexFormat MESH_FORMAT = VERTEX_SNORM16X2;
   std::unique_ptr<mgl::ShaderProgram> Shaders = nullptr;
-  GLint MatrixId, ColorId; 
-  std::vector<Shape2D> shapes;
-  
+  std::unique_ptr<GeometryBuffer> Geometry = nullptr;
+  std::unique_ptr<PieceRenderer> Renderer = nullptr;
+  std::unique_ptr<mgl::ShaderProgram> SdfShaders = nullptr;
+  std::unique_ptr<SdfPieces> Sdf = nullptr;
+  std::unique_ptr<PieceRenderer> SdfRenderer = nullptr;
+  std::unique_ptr<PieceRenderer> MovingRenderer = nullptr;
+  std::unique_ptr<PieceRenderer> MovingSdfRenderer = nullptr;
+  // The table simulated on the main thread, and the one drawn from its
+  // snapshots, along with the state only the render thread touches
+  std::unique_ptr<PieceTable> Pieces = nullptr;
+  mgl::TripleBuffer<SceneSnapshot> Snapshots;
+  std::unique_ptr<PieceTable> DrawnPieces = nullptr;
+  unsigned long DrawnRevision = 0;
+  bool DrawnValid = false;
+  bool DrawnSdf = false;
+  float DrawnOutline = 0.0f;
+  std::unique_ptr<TransformCache> Transforms = nullptr;
+  // Rows of the drawn table changed by the last snapshot, e.g. during a
+  // transition, are drawn over the layer, which only holds the other ones
+  std::vector<std::uint8_t> Moving, Changed;
+  std::size_t MovingCount = 0;
+  std::unique_ptr<PieceTable> StaticPieces = nullptr;
+  std::unique_ptr<PieceTable> MovingPieces = nullptr;
+  std::uint64_t StaticVersion = 0;
+  unsigned long StaticRebuild = 0;
+  mgl::RenderQueue Queue;
+  std::unique_ptr<mgl::CommandRecorder> Recorder = nullptr;
+  mgl::Layer StaticLayer;
+  int Width = 0, Height = 0;
+  std::string LibraryFile;
+  FigureLibrary Figures;
+  std::size_t CurrentFigure = 0;
+  FigureTransition Transition;
+  bool UseSdf;
+  float OutlineWidth = 0.0f;
+  bool Benchmark;
+  std::string CaptureFile;
 
   void createShaderProgram();
   void createBufferObjects();
   void destroyBufferObjects();
+  void createPieces();
+  bool showFigure(std::size_t index);
+  void applyScene(const SceneSnapshot &scene);
+  void splitPieces(bool moving, PieceTable &rows) const;
+  mgl::ShaderProgram &bindPieces();
   void drawScene();
-  std::unordered_map<std::string, glm::mat4> calculations();
+  void captureFrame();
 };
 
 //////////////////////////////////////////////////////////////////////// SHADERs
@@ -60,295 +124,404 @@ void MyApp::createShaderProgram() {
   Shaders->addShader(GL_FRAGMENT_SHADER, "clip-fs.glsl");
 
   Shaders->addAttribute(mgl::POSITION_ATTRIBUTE, POSITION);
-  Shaders->addAttribute(mgl::COLOR_ATTRIBUTE, COLOR);
 
-  // Register both uniforms used by the application
-  Shaders->addUniform("Matrix");
-  Shaders->addUniform("Color");
+  // Matrices and colors of every piece are read from storage blocks
+  Shaders->addStorageBlock(PIECE_MATRICES_BLOCK, PIECE_MATRICES_BINDING);
+  Shaders->addStorageBlock(PIECE_COLORS_BLOCK, PIECE_COLORS_BINDING);
+  Geometry->addTo(*Shaders);
 
   Shaders->create();
-
-  // Retrieve uniform locations/indices after program creation
-  MatrixId = Shaders->Uniforms["Matrix"].index;
-  ColorId = Shaders->Uniforms["Color"].index; 
+  Renderer->check(*Shaders);
+  Geometry->setUniforms(*Shaders);
+
+  // Alternative path: bounding quads shaded from the distance to the shape
+  SdfShaders = std::make_unique<mgl::ShaderProgram>();
+  SdfShaders->addShader(GL_VERTEX_SHADER, "sdf-vs.glsl");
+  SdfShaders->addShader(GL_FRAGMENT_SHADER, "sdf-fs.glsl");
+  SdfShaders->addAttribute(mgl::POSITION_ATTRIBUTE, POSITION);
+  SdfShaders->addStorageBlock(PIECE_MATRICES_BLOCK, PIECE_MATRICES_BINDING);
+  SdfShaders->addStorageBlock(PIECE_COLORS_BLOCK, PIECE_COLORS_BINDING);
+  Sdf->addTo(*SdfShaders);
+  SdfShaders->create();
+  SdfRenderer->check(*SdfShaders);
+  Sdf->check(*SdfShaders);
 }
 
 //////////////////////////////////////////////////////////////////// VAOs & VBOs
 
 void MyApp::createBufferObjects() {
-	Shape2D triangle_shape(TRIANGLE);
-	shapes.push_back(std::move(triangle_shape));
-
-	Shape2D square_shape(SQUARE);
-	shapes.push_back(std::move(square_shape));
-
-	Shape2D parallelogram_shape(PARALLELOGRAM);
-	shapes.push_back(std::move(parallelogram_shape));
+	// The shapes make no GL object of their own: every one is drawn from the
+	// shared buffers by a single indirect call
+	const std::vector<Shape2D> shapes = {Shape2D(TRIANGLE, MESH_FORMAT), Shape2D(SQUARE, MESH_FORMAT),
+		Shape2D(PARALLELOGRAM, MESH_FORMAT)};
+	Geometry = std::make_unique<GeometryBuffer>(shapes, MESH_FORMAT);
+	Renderer = std::make_unique<PieceRenderer>(*Geometry);
+
+	Sdf = std::make_unique<SdfPieces>();
+	SdfRenderer = std::make_unique<PieceRenderer>(Sdf->getGeometry());
+	MovingRenderer = std::make_unique<PieceRenderer>(*Geometry);
+	MovingSdfRenderer = std::make_unique<PieceRenderer>(Sdf->getGeometry());
 }
 
 void MyApp::destroyBufferObjects() {
-    for (auto& shape : shapes) {
-		shape.destroy();
-    }
-    glBindVertexArray(0);
+    StaticLayer.destroy();
+    MovingSdfRenderer->destroy();
+    MovingRenderer->destroy();
+    SdfRenderer->destroy();
+    Sdf->destroy();
+    Renderer->destroy();
+    Geometry->destroy();
+    mgl::StateCache::getInstance().bindVertexArray(0);
 }
 
 ////////////////////////////////////////////////////////////////////////// SCENE
 
-std::unordered_map<std::string, glm::mat4> MyApp::calculations() {
-	// Global scale for pieces. (Scales above 0.5f may cause pieces to go out of view)
-    const float global_scale = 0.5f;
-
-    /* Tangram piece sizes:
-		-The square side length is half the biggest triangle side length.
-		-The parallelogram side length is also half the biggest triangle side length.
-		-The small triangles side length is half the biggest triangle side length.
-		-The medium triangle side length is the same as the biggest triangle side length divided by sqrt(2).
-	   This sizes are fixed and should not be changed to maintain the Tangram proportions.
-    */
-
-    const float square_ratio = 0.5f;
-    const float medium_triangle_ratio = 1 / glm::sqrt(2);
-	const float small_triangle_ratio = 0.5f;
-	const float parallelogram_ratio = 0.5f;
-
-    // Square calculations
-    // Variables
-    const float square_side = square_ratio * global_scale * shapes[SQUARE].getSideLength();
-
-    const float square_diagonal = glm::sqrt(2 * glm::pow(square_side, 2));
-
-    // Positioning
-    // Center of the Tangram is the square center. Moving the square moves the entire Tangram.
-    const float square_x_offset = 0.0f;
-
-    const float square_y_offset = 0.0f;
-
-
-	// First triangle calculations (Magenta triangle)
-    // Variables
-    const float triangle_side = global_scale * shapes[TRIANGLE].getSideLength();
-
-    const float triangle_hypotenuse = glm::sqrt(glm::pow(triangle_side, 2) * 2);
-
-    const float triangle_height = glm::sqrt(glm::pow(triangle_side, 2) - glm::pow(triangle_hypotenuse / 2, 2));
-
-    const float centroid = (triangle_side / 3);  // Triangle is isosceles so the x and y centroids are equal
-
-    const float triangle_centroid_diagonal = glm::sqrt(2 * glm::pow(centroid, 2));
-
-    // Positioning
-    const float first_triangle_x_offset = -(square_diagonal / 2 - centroid) + square_x_offset;
-
-    const float first_triangle_y_offset = -(triangle_side - centroid) + square_y_offset;
-
-
-	// Second triangle calculations (Cyan triangle)
-    // Variables
-    const float second_triangle_side = small_triangle_ratio * triangle_side;
-
-    const float second_triangle_hypotenuse = glm::sqrt(glm::pow(second_triangle_side, 2) * 2);
-
-    const float second_triangle_centroid = (second_triangle_side / 3);
-
-    const float second_triangle_height = glm::sqrt(glm::pow(second_triangle_side, 2) - glm::pow(second_triangle_hypotenuse / 2, 2));
-
-    const float second_triangle_centroid_diagonal = glm::sqrt(2 * glm::pow(second_triangle_centroid, 2));
-
-    // Positioning
-    const float second_triangle_x_offset = -(centroid - (second_triangle_height - second_triangle_centroid_diagonal)) + first_triangle_x_offset;
-
-    const float second_triangle_y_offset = (triangle_side + (second_triangle_hypotenuse / 2 - centroid)) + first_triangle_y_offset;
-
-
-	// Third triangle calculations (Light Blue triangle)
-    // Variables
-    const float third_triangle_hypotenuse = triangle_hypotenuse;
-
-    const float third_triangle_centroid_diagonal = triangle_centroid_diagonal;
-
-    const float third_triangle_height = triangle_height;
-
-    // Positioning
-    const float third_triangle_x_offset = third_triangle_hypotenuse / 2 + square_x_offset;
-
-    const float third_triangle_y_offset = -(square_diagonal / 2 - (third_triangle_height - third_triangle_centroid_diagonal)) + square_y_offset;
-
-
-	// Fourth triangle calculations (Purple triangle)
-    // Variables
-    const float fourth_triangle_side = triangle_side * medium_triangle_ratio;
-
-    const float fourth_triangle_centroid = (fourth_triangle_side / 3);
-
-    // Positioning
-    const float fourth_triangle_x_offset = -fourth_triangle_centroid + square_x_offset;
-
-    const float fourth_triangle_y_offset = (fourth_triangle_side - fourth_triangle_centroid) + (square_diagonal / 2) + square_y_offset;
-
-
-	// Fifth triangle calculations (Red triangle)
-    // Variables
-    const float fifth_triangle_side = second_triangle_side;
-
-    const float fifth_triangle_hypotenuse = second_triangle_hypotenuse;
-
-    const float fifth_triangle_centroid_diagonal = second_triangle_centroid_diagonal;
-
-    const float fifth_triangle_height = second_triangle_height;
-
-    // Positioning
-    const float fifth_triangle_x_offset = -(fourth_triangle_side - fourth_triangle_centroid) + fourth_triangle_x_offset;
-
-    const float fifth_triangle_y_offset = -(fifth_triangle_height - (fourth_triangle_centroid + (fifth_triangle_height - fifth_triangle_centroid_diagonal))) + fourth_triangle_y_offset;
-
-
-    //Parallelogram
-    // Variables
-	const float parallelogram_side = shapes[PARALLELOGRAM].getSideLength() * global_scale * parallelogram_ratio;
-
-    const float parallelogram_heigth = parallelogram_side * glm::sin(glm::radians(45.0f));
-
-    // Positioning
-    const float parallelogram_x_offset = (triangle_side - centroid / 2) + first_triangle_x_offset;
-
-    const float parallelogram_y_offset = -(centroid + parallelogram_heigth / 2) + first_triangle_y_offset;
-
-
-    // Transformation Matrices
-	std::unordered_map<std::string, glm::mat4> matrices = {};
-    
-    // All transformation are done in the correct scale, rotate and translate order. An additional rotation is done afterwards because the tangram is slighty tilted to the left.
-    const glm::mat4 I(1.0f);
-    const glm::mat4 global_rotation = glm::mat4_cast(glm::quat(glm::radians(glm::vec3(0.0f, 0.0f, 10.0f))));
-
-    const glm::mat4 first_triangle_transform =
-        global_rotation
-        * glm::mat4(glm::translate(I, glm::vec3(first_triangle_x_offset, first_triangle_y_offset, 0.0f)))
-        * glm::mat4_cast(glm::quat(glm::radians(glm::vec3(0.0f, 0.0f, 0.0f))))
-        * glm::mat4(glm::scale(I, glm::vec3(global_scale, global_scale, 1.0f)));
-
-    matrices.insert({"first_triangle_transform", first_triangle_transform});
-
-    const glm::mat4 square_transform =
-        global_rotation
-        * glm::mat4(glm::translate(I, glm::vec3(square_x_offset, square_y_offset, 0.0f)))
-        * glm::mat4_cast(glm::quat(glm::radians(glm::vec3(0.0f, 0.0f, 45.0f))))
-        * glm::mat4(glm::scale(I, glm::vec3(global_scale / 2, global_scale / 2, 1.0f)));
-
-	matrices.insert({ "square_transform", square_transform });
-
-    const glm::mat4 second_triangle_transform =
-        global_rotation
-        * glm::mat4(glm::translate(I, glm::vec3(second_triangle_x_offset, second_triangle_y_offset, 0.0f)))
-        * glm::mat4_cast(glm::quat(glm::radians(glm::vec3(0.0f, 0.0f, 135.0f))))
-        * glm::mat4(glm::scale(I, glm::vec3(global_scale / 2, global_scale / 2, 1.0f)));
-
-	matrices.insert({ "second_triangle_transform", second_triangle_transform });
-
-    const glm::mat4 third_triangle_transform =
-        global_rotation
-        * glm::mat4(glm::translate(I, glm::vec3(third_triangle_x_offset, third_triangle_y_offset, 0.0f)))
-        * glm::mat4_cast(glm::quat(glm::radians(glm::vec3(0.0f, 0.0f, -135.0f))))
-        * glm::mat4(glm::scale(I, glm::vec3(global_scale, global_scale, 1.0f)));
-
-	matrices.insert({ "third_triangle_transform", third_triangle_transform });
-
-    const glm::mat4 fourth_triangle_transform =
-        global_rotation
-        * glm::mat4(glm::translate(I, glm::vec3(fourth_triangle_x_offset, fourth_triangle_y_offset, 0.0f)))
-        * glm::mat4_cast(glm::quat(glm::radians(glm::vec3(0.0f, 0.0f, 180.0f))))
-        * glm::mat4(glm::scale(I, glm::vec3(global_scale / glm::sqrt(2), global_scale / glm::sqrt(2), 1.0f)));
-
-	matrices.insert({ "fourth_triangle_transform", fourth_triangle_transform });
-
-    const glm::mat4 fifth_triangle_transform =
-        global_rotation
-        * glm::mat4(glm::translate(I, glm::vec3(fifth_triangle_x_offset, fifth_triangle_y_offset, 0.0f)))
-        * glm::mat4_cast(glm::quat(glm::radians(glm::vec3(0.0f, 0.0f, -135.0f))))
-        * glm::mat4(glm::scale(I, glm::vec3(global_scale / 2, global_scale / 2, 1.0f)));
+void MyApp::createPieces() {
+  Pieces = std::make_unique<PieceTable>();
+  DrawnPieces = std::make_unique<PieceTable>();
+  StaticPieces = std::make_unique<PieceTable>();
+  MovingPieces = std::make_unique<PieceTable>();
+  Transforms = std::make_unique<TransformCache>();
+  if (!LibraryFile.empty()) {
+    Figures.open(LibraryFile);
+  }
+  if (Figures.size() == 0 || !showFigure(0)) {
+    layoutDragon(*Pieces);
+    Pieces->sortByMesh();
+  }
+}
 
-	matrices.insert({ "fifth_triangle_transform", fifth_triangle_transform });
+// Returns false, and keeps the current figure, if the library entry is invalid.
+bool MyApp::showFigure(std::size_t index) {
+  // Figures are read in place from the mapped library
+  FigureView figure;
+  try {
+    figure = Figures.getFigure(index);
+    checkFigure(figure);
+  } catch (const std::exception &e) {
+    // Also called from key callbacks, which exceptions must not leave
+    std::cerr << "Cannot show figure " << index + 1 << ": " << e.what()
+              << std::endl;
+    return false;
+  }
+  CurrentFigure = index;
+  Transition.capture(*Pieces);
+  loadFigure(figure, *Pieces);
+  // The pieces glide to the new figure when it is made of the same ones
+  Transition.start(*Pieces);
+  std::cout << "Figure " << index + 1 << "/" << Figures.size() << ": "
+            << figure.name << std::endl;
+  return true;
+}
 
-    const glm::mat4 parallelogram_transform =
-        global_rotation
-        * glm::mat4(glm::translate(I, glm::vec3(parallelogram_x_offset, parallelogram_y_offset, 0.0f)))
-        * glm::mat4_cast(glm::quat(glm::radians(glm::vec3(0.0f, 0.0f, 0.0f))))
-        * glm::mat4(glm::scale(I, glm::vec3(global_scale / 2, global_scale / 2, 1.0f)));
+// Brings the drawn table and the settings of the renderers to the last
+// snapshot of the scene.
+void MyApp::applyScene(const SceneSnapshot &scene) {
+  if (!DrawnValid || scene.revision != DrawnRevision) {
+    if (applySnapshot(scene, *DrawnPieces, Changed)) {
+      Transforms->attach(*DrawnPieces);
+      StaticVersion++;
+    }
+    DrawnRevision = scene.revision;
+    DrawnValid = true;
+  } else {
+    Changed.assign(DrawnPieces->size(), 0);
+  }
+  // Pieces that stop or start moving go into or out of the layer
+  if (Changed != Moving) {
+    Moving.swap(Changed);
+    MovingCount = std::count(Moving.begin(), Moving.end(), 1);
+    StaticVersion++;
+  }
+  // Neither changes the version of the layer, which is redrawn explicitly
+  if (scene.use_sdf != DrawnSdf || scene.outline_width != DrawnOutline) {
+    DrawnSdf = scene.use_sdf;
+    DrawnOutline = scene.outline_width;
+    Sdf->setOutline(DrawnOutline, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+    StaticLayer.invalidate();
+  }
+}
 
-	matrices.insert({ "parallelogram_transform", parallelogram_transform });
+// Fills the table with the drawn pieces that moved, or with those that did not,
+// along with their matrices.
+void MyApp::splitPieces(bool moving, PieceTable &rows) const {
+  rows.clear();
+  for (PieceId id = 0; id < DrawnPieces->size(); id++) {
+    if ((Moving[id] != 0) == moving) {
+      const PieceId row = rows.add(
+          DrawnPieces->getMesh(id), DrawnPieces->getPosition(id),
+          DrawnPieces->getRotation(id), DrawnPieces->getScale(id),
+          DrawnPieces->getColor(id));
+      rows.getMatrices()[row] = DrawnPieces->getMatrix(id);
+    }
+  }
+  rows.clearDirty();
+}
 
-	return matrices;
+// Sets the state of the path the pieces are drawn with and returns its program.
+mgl::ShaderProgram &MyApp::bindPieces() {
+  if (DrawnSdf) {
+    Sdf->bind(*SdfShaders, Width, Height);
+    return *SdfShaders;
+  }
+  mgl::StateCache::getInstance().disable(GL_BLEND);
+  return *Shaders;
 }
 
 void MyApp::drawScene() {
+  mgl::JobSystem &jobs = mgl::Engine::getInstance().getJobs();
+  const ParallelFor parallel_for =
+      [&jobs](std::size_t count,
+              const std::function<void(std::size_t, std::size_t)> &body) {
+        jobs.parallelFor(count, body);
+      };
+
+  // Transformation matrices are only recomputed when the layout changes,
+  // split across the worker threads
+  Transforms->update(*DrawnPieces, parallel_for);
+
+  // Matrices rebuilt for pieces at rest, e.g. with the whole figure, change
+  // the layer too, whether other pieces move or not
+  if (Transforms->getRebuildCount() != StaticRebuild) {
+    StaticRebuild = Transforms->getRebuildCount();
+    for (PieceId id = 0; id < DrawnPieces->size(); id++) {
+      if (Moving[id] == 0 && Transforms->wasUpdated(id)) {
+        StaticVersion++;
+        break;
+      }
+    }
+  }
+
+  // The layer holds the pieces at rest and is only redrawn when they change,
+  // so frames where nothing moved are a single textured triangle
+  mgl::GpuProfiler &profiler = mgl::Engine::getInstance().getGpuProfiler();
+  if (!StaticLayer.isValid(Width, Height, StaticVersion)) {
+    mgl::GpuScope scope(profiler, "pieces");
+    StaticLayer.begin(Width, Height, StaticVersion);
+    splitPieces(false, *StaticPieces);
+    PieceRenderer &renderer = DrawnSdf ? *SdfRenderer : *Renderer;
+    mgl::ShaderProgram &shaders = bindPieces();
+    // Each worker copies its range of pieces into the instance buffer, and
+    // the draws are issued from this thread. The queue orders the draws by
+    // program and vertex array, which stay bound, so binding them again is
+    // elided.
+    renderer.record(*Recorder, *StaticPieces, *Transforms, shaders);
+    Recorder->submit(Queue);
+    Queue.sort();
+    Queue.flush();
+    renderer.fence();
+    StaticLayer.end();
+  }
+  {
+    mgl::GpuScope scope(profiler, "composite");
+    StaticLayer.composite();
+  }
+
+  // Pieces on the move are drawn over the layer every frame
+  if (MovingCount > 0) {
+    mgl::GpuScope scope(profiler, "moving");
+    splitPieces(true, *MovingPieces);
+    PieceRenderer &renderer = DrawnSdf ? *MovingSdfRenderer : *MovingRenderer;
+    mgl::ShaderProgram &shaders = bindPieces();
+    renderer.update(*MovingPieces, *Transforms);
+    renderer.submit(Queue, shaders);
+    Queue.sort();
+    Queue.flush();
+    renderer.fence();
+  }
+}
 
-// Get transformation matrices
-  const auto matrices = calculations();
-
-  Shaders->bind();
-
-  // TRIANGLES
-  glBindVertexArray(shapes[TRIANGLE].get_vao());
-  glUniformMatrix4fv(MatrixId, 1, GL_FALSE, glm::value_ptr(matrices.at("first_triangle_transform")));
-  glUniform4fv(ColorId, 1, glm::value_ptr(glm::vec4(1.0f, 0.0f, 1.0f, 1.0f))); // Magenta
-  shapes[TRIANGLE].draw();
-
-  glUniformMatrix4fv(MatrixId, 1, GL_FALSE, glm::value_ptr(matrices.at("second_triangle_transform")));
-  glUniform4fv(ColorId, 1, glm::value_ptr(glm::vec4(0.0f, 1.0f, 1.0f, 1.0f))); // Cyan
-  shapes[TRIANGLE].draw();
-
-  glUniformMatrix4fv(MatrixId, 1, GL_FALSE, glm::value_ptr(matrices.at("third_triangle_transform")));
-  glUniform4fv(ColorId, 1, glm::value_ptr(glm::vec4(0.3f, 0.6f, 1.0f, 1.0f))); // Light Blue
-  shapes[TRIANGLE].draw();
-
-  glUniformMatrix4fv(MatrixId, 1, GL_FALSE, glm::value_ptr(matrices.at("fourth_triangle_transform")));
-  glUniform4fv(ColorId, 1, glm::value_ptr(glm::vec4(0.5f, 0.0f, 0.5f, 1.0f))); // Purple
-  shapes[TRIANGLE].draw();
-
-  glUniformMatrix4fv(MatrixId, 1, GL_FALSE, glm::value_ptr(matrices.at("fifth_triangle_transform")));
-  glUniform4fv(ColorId, 1, glm::value_ptr(glm::vec4(1.0f, 0.0f, 0.0f, 1.0f))); // Red
-  shapes[TRIANGLE].draw();
-
-  // SQUARE
-  glBindVertexArray(shapes[SQUARE].get_vao());
-  glUniformMatrix4fv(MatrixId, 1, GL_FALSE, glm::value_ptr(matrices.at("square_transform")));
-  glUniform4fv(ColorId, 1, glm::value_ptr(glm::vec4(0.0f, 0.7f, 0.0f, 1.0f))); // Green
-  shapes[SQUARE].draw();
-
-  // PARALLELOGRAM
-  glBindVertexArray(shapes[PARALLELOGRAM].get_vao());
-  glUniformMatrix4fv(MatrixId, 1, GL_FALSE, glm::value_ptr(matrices.at("parallelogram_transform")));
-  glUniform4fv(ColorId, 1, glm::value_ptr(glm::vec4(1.0f, 0.5f, 0.0f, 1.0f))); // Orange
-  shapes[PARALLELOGRAM].draw();
-
-  // Unbind
-  Shaders->unbind();
-  glBindVertexArray(0);
+// Writes the last frame as a binary PPM, top row first.
+void MyApp::captureFrame() {
+  std::vector<GLubyte> rgba;
+  int width = 0, height = 0;
+  mgl::Engine::getInstance().readPixels(rgba, width, height);
+  std::ofstream file(CaptureFile, std::ios::binary);
+  if (!file) {
+    std::cerr << "Cannot write " << CaptureFile << std::endl;
+    return;
+  }
+  file << "P6\n" << width << " " << height << "\n255\n";
+  for (int y = height - 1; y >= 0; y--) {
+    for (int x = 0; x < width; x++) {
+      file.write(reinterpret_cast<const char *>(&rgba[(y * width + x) * 4]),
+                 3);
+    }
+  }
+  std::cout << "Frame written to " << CaptureFile << std::endl;
 }
 
 ////////////////////////////////////////////////////////////////////// CALLBACKS
 
 void MyApp::initCallback(GLFWwindow *win) {
+  glfwGetFramebufferSize(win, &Width, &Height);
+  Recorder = std::make_unique<mgl::CommandRecorder>(
+      mgl::Engine::getInstance().getJobs());
   createBufferObjects();
   createShaderProgram();
+  createPieces();
+  if (Benchmark) {
+    runFillBenchmark(*Geometry, *Shaders, *Sdf, *SdfShaders, Width, Height);
+    glfwSetWindowShouldClose(win, GLFW_TRUE);
+  }
 }
 
-void MyApp::windowCloseCallback(GLFWwindow *win) { destroyBufferObjects(); }
+void MyApp::windowCloseCallback(GLFWwindow *win) {
+  std::cout << "Transforms rebuilt " << Transforms->getRebuildCount()
+            << " times in " << Transforms->getFrameCount() << " frames ("
+            << Transforms->getSceneGraph().getTotalUpdateCount()
+            << " nodes recomputed), instance buffer written "
+            << Renderer->getUploadCount() << " times, "
+            << Renderer->getSubmitCount() << " draw calls, "
+            << Renderer->getFenceWaits() << " fence waits ("
+            << Renderer->getFenceWaitTime() * 1000.0 << " ms)" << std::endl;
+  const mgl::StateCache &state = mgl::StateCache::getInstance();
+  std::cout << "State changes: " << state.getTotalChanges() << " issued, "
+            << state.getTotalElided() << " elided (last frame "
+            << state.getFrameChanges() << " issued, " << state.getFrameElided()
+            << " elided)" << std::endl;
+  std::cout << "Render queue: " << Queue.getProgramSwitches()
+            << " program and " << Queue.getVertexArraySwitches()
+            << " vertex array switches in the last flush" << std::endl;
+  const mgl::Engine &engine = mgl::Engine::getInstance();
+  std::cout << engine.getFrameCount() << " frames drawn, idle for "
+            << engine.getIdleTime() << " s" << std::endl;
+  std::cout << "Static layer drawn " << StaticLayer.getRedrawCount()
+            << " times, composited " << StaticLayer.getCompositeCount()
+            << " times" << std::endl;
+  if (!CaptureFile.empty()) {
+    captureFrame();
+  }
+  destroyBufferObjects();
+}
 
 void MyApp::windowSizeCallback(GLFWwindow *win, int winx, int winy) {
   glViewport(0, 0, winx, winy);
+  Width = winx;
+  Height = winy;
 }
 
-void MyApp::displayCallback(GLFWwindow *win, double elapsed) { drawScene(); }
+void MyApp::keyCallback(GLFWwindow *win, int key, int scancode, int action,
+                        int mods) {
+  if (action == GLFW_RELEASE) {
+    return;
+  }
+  if (key == GLFW_KEY_T) {
+    mgl::Engine::getInstance().requestTimingReport();
+    return;
+  }
+  if (key == GLFW_KEY_S) {
+    UseSdf = !UseSdf;
+  } else if (key == GLFW_KEY_O) {
+    // Outlines are drawn by the SDF path only
+    OutlineWidth = OutlineWidth > 0.0f ? 0.0f : 1.5f;
+  } else if (key == GLFW_KEY_RIGHT && Figures.size() > 0) {
+    showFigure((CurrentFigure + 1) % Figures.size());
+  } else if (key == GLFW_KEY_LEFT && Figures.size() > 0) {
+    showFigure((CurrentFigure + Figures.size() - 1) % Figures.size());
+  } else {
+    return;
+  }
+  // The engine only draws when asked, the figure is a still image
+  mgl::Engine::getInstance().requestRedraw();
+}
+
+void MyApp::updateCallback(GLFWwindow *win, double step) {
+  Transition.update(step);
+}
+
+// On the main thread, while the previous frame may still be drawn from the
+// render thread.
+void MyApp::snapshotCallback(GLFWwindow *win) {
+  mgl::Engine &engine = mgl::Engine::getInstance();
+  if (Transition.apply(*Pieces, engine.getUpdateAlpha())) {
+    engine.requestRedraw();
+  }
+  SceneSnapshot &scene = Snapshots.getBack();
+  takeSnapshot(*Pieces, scene);
+  scene.use_sdf = UseSdf;
+  scene.outline_width = OutlineWidth;
+  Snapshots.publish();
+}
+
+void MyApp::displayCallback(GLFWwindow *win, double elapsed) {
+  Snapshots.acquire();
+  applyScene(Snapshots.getFront());
+  drawScene();
+}
 
 /////////////////////////////////////////////////////////////////////////// MAIN
 
+// Usage: Tangram_2D [--sdf] [--benchmark-fill] [--headless frames]
+//                   [--capture frame.ppm] [--render-thread] [figures.tgl]
+//        Tangram_2D --write-library figures.tgl
+// T prints the CPU and GPU timings so far.
+// --sdf starts with the SDF path (S toggles it, O toggles outlines) and
+// --benchmark-fill compares its fill cost to MSAA then exits. --headless
+// draws the given number of frames without a display and --capture writes the
+// last one when the app exits, which headless it does by itself.
+// --render-thread draws on a thread of its own, see mgl::Engine.
+static void printUsage() {
+  std::cerr << "Usage: Tangram_2D [--sdf] [--benchmark-fill]"
+            << " [--headless frames]\n"
+            << "                  [--capture frame.ppm] [--render-thread]"
+            << " [figures.tgl]\n"
+            << "       Tangram_2D --write-library figures.tgl" << std::endl;
+}
+
+// Unlike std::stoul, rejects signs, trailing characters and overflow
+// without throwing.
+static bool parseFrames(const char *text, unsigned long &frames) {
+  if (!std::isdigit(static_cast<unsigned char>(text[0]))) {
+    return false;
+  }
+  char *end = nullptr;
+  errno = 0;
+  frames = std::strtoul(text, &end, 10);
+  return errno == 0 && *end == '\0';
+}
+
 int main(int argc, char *argv[]) {
+  if (argc > 2 && std::string(argv[1]) == "--write-library") {
+    FigureDescription dragon = {"dragon", {}};
+    dragon.pieces.assign(DRAGON_LAYOUT.begin(), DRAGON_LAYOUT.end());
+    writeFigureLibrary(argv[2], {dragon});
+    exit(EXIT_SUCCESS);
+  }
+  std::string library, capture;
+  bool sdf = false, benchmark = false, render_thread = false;
+  unsigned long headless_frames = 0;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if (arg == "--sdf") {
+      sdf = true;
+    } else if (arg == "--benchmark-fill") {
+      benchmark = true;
+    } else if (arg == "--headless" && i + 1 < argc) {
+      if (!parseFrames(argv[++i], headless_frames)) {
+        printUsage();
+        exit(EXIT_FAILURE);
+      }
+    } else if (arg == "--capture" && i + 1 < argc) {
+      capture = argv[++i];
+    } else if (arg == "--render-thread") {
+      render_thread = true;
+    } else {
+      library = arg;
+    }
+  }
+
   mgl::Engine &engine = mgl::Engine::getInstance();
-  engine.setApp(new MyApp());
-  engine.setOpenGL(4, 6);
+  engine.setApp(new MyApp(library, sdf, benchmark, capture));
+  // 4.5 and ARB_shader_draw_parameters, so that Mesa llvmpipe can run it
+  engine.setOpenGL(4, 5);
   engine.setWindow(1000, 1000, "Tangram 2D", 0, 1);
+  engine.setOnDemand(true);
+  engine.setRenderThread(render_thread);
+  if (headless_frames > 0) {
+    engine.setHeadless(true);
+    engine.setFrameLimit(headless_frames);
+  }
   engine.init();
   engine.run();
   exit(EXIT_SUCCESS);
@@ -0,0 +1,83 @@
+#include "TransformCache.h"
+
+
+void layoutDragon(PieceTable& pieces) {
+    // The layout and the matrices for the default global transformation are computed at compile time
+    pieces.clear();
+    for (const PieceLayout& piece : DRAGON_LAYOUT) {
+        const PieceId id = pieces.add(piece.mesh, glm::vec2(piece.x, piece.y), piece.rotation, piece.scale,
+            glm::make_vec4(piece.color));
+        pieces.getMatrices()[id] = cx::toGlm(DRAGON_MATRICES[id]);
+    }
+    pieces.clearDirty();
+}
+
+
+TransformCache::TransformCache()
+    : figure(NO_PARENT), global_scale(DEFAULT_GLOBAL_SCALE), global_rotation(DEFAULT_GLOBAL_ROTATION),
+      frame_count(0), rebuild_count(0) {}
+
+void TransformCache::setGlobalScale(float scale) {
+    global_scale = scale;
+    if (figure != NO_PARENT) {
+        graph.setScale(figure, scale);
+    }
+}
+
+void TransformCache::setGlobalRotation(float degrees) {
+    global_rotation = degrees;
+    if (figure != NO_PARENT) {
+        graph.setRotation(figure, degrees);
+    }
+}
+
+void TransformCache::attach(PieceTable& pieces) {
+    // A clean table already holds valid matrices, which seed the graph
+    const bool seed = !pieces.isDirty();
+    const glm::mat4 figure_world =
+        glm::mat4_cast(glm::quat(glm::radians(glm::vec3(0.0f, 0.0f, global_rotation))))
+        * glm::scale(glm::mat4(1.0f), glm::vec3(global_scale, global_scale, 1.0f));
+
+    graph.clear();
+    piece_nodes.clear();
+    figure = graph.addNode(NO_PARENT, glm::vec2(0.0f), global_rotation, global_scale,
+        seed ? &figure_world : nullptr);
+    for (std::size_t id = 0; id < pieces.size(); id++) {
+        piece_nodes.push_back(graph.addNode(figure, pieces.getPosition(id), pieces.getRotation(id),
+            pieces.getScale(id), seed ? &pieces.getMatrix(id) : nullptr));
+    }
+    pieces.clearDirty();
+}
+
+void TransformCache::update(PieceTable& pieces, const ParallelFor& parallel_for) {
+    frame_count++;
+    if (piece_nodes.size() != pieces.size()) {
+        attach(pieces);
+    }
+    else if (pieces.isDirty()) {
+        for (std::size_t id = 0; id < pieces.size(); id++) {
+            if (pieces.isPieceDirty(id)) {
+                graph.setLocal(piece_nodes[id], pieces.getPosition(id), pieces.getRotation(id), pieces.getScale(id));
+            }
+        }
+        pieces.clearDirty();
+    }
+
+    if (graph.update(parallel_for) > 0) {
+        glm::mat4* matrices = pieces.getMatrices();
+        const auto copy = [&](std::size_t begin, std::size_t end) {
+            for (std::size_t id = begin; id < end; id++) {
+                if (graph.wasUpdated(piece_nodes[id])) {
+                    matrices[id] = graph.getWorld(piece_nodes[id]);
+                }
+            }
+        };
+        if (parallel_for) {
+            parallel_for(pieces.size(), copy);
+        }
+        else {
+            copy(0, pieces.size());
+        }
+        rebuild_count++;
+    }
+}
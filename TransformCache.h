@@ -0,0 +1,60 @@
+#pragma once
+
+#include "../mgl/mgl.hpp"
+#include "DragonLayout.h"
+#include "PieceTable.h"
+#include "SceneGraph.h"
+#include <vector>
+
+// Pieces of the dragon figure, added in mesh order so that their PieceIds are
+// also their rows in the PieceTable.
+constexpr PieceId FIRST_TRIANGLE = 0;  // Magenta
+constexpr PieceId SECOND_TRIANGLE = 1; // Cyan
+constexpr PieceId THIRD_TRIANGLE = 2;  // Light Blue
+constexpr PieceId FOURTH_TRIANGLE = 3; // Purple
+constexpr PieceId FIFTH_TRIANGLE = 4;  // Red
+constexpr PieceId SQUARE_PIECE = 5;    // Green
+constexpr PieceId PARALLELOGRAM_PIECE = 6; // Orange
+constexpr PieceId PIECE_COUNT = 7;
+
+// Fills the table with the seven pieces of the dragon figure, in figure space at
+// unit scale, along with their matrices for the default global transformation.
+void layoutDragon(PieceTable& pieces);
+
+// Writes the matrices column of a PieceTable through a scene graph with one
+// figure node (global scale and rotation) parent of one node per piece. Only
+// the subtrees that changed are recomputed and steady-state frames do no
+// matrix math. The cache starts out with the default global scale and
+// rotation, so a table filled by layoutDragon() needs no rebuild at startup.
+class TransformCache {
+	private:
+		SceneGraph graph;
+		NodeId figure;
+		std::vector<NodeId> piece_nodes; // Indexed by PieceId
+		float global_scale;
+		float global_rotation; // Degrees around the z axis
+
+		unsigned long frame_count;
+		unsigned long rebuild_count;
+
+	public:
+		TransformCache();
+
+		// Rebuilds the graph from the table. Called by update() when the number of
+		// pieces changes, and must be called when the rows are replaced in place
+		// (e.g. another figure of the same size is loaded).
+		void attach(PieceTable& pieces);
+
+		void setGlobalScale(float scale);
+		void setGlobalRotation(float degrees);
+
+		// Called once per frame, recomputes the matrices of the pieces that changed,
+		// split across threads by parallel_for if given.
+		void update(PieceTable& pieces, const ParallelFor& parallel_for = nullptr);
+
+		// Whether the last update() recomputed the matrix of the piece.
+		bool wasUpdated(PieceId id) const { return graph.wasUpdated(piece_nodes[id]); }
+		const SceneGraph& getSceneGraph() const { return graph; }
+		unsigned long getFrameCount() const { return frame_count; }
+		unsigned long getRebuildCount() const { return rebuild_count; }
+};
@@ -0,0 +1,50 @@
+#include "VertexFormat.h"
+#include <glm/gtc/packing.hpp>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+
+const VertexLayout& vertexLayout(VertexFormat format) {
+    if (format < 0 || format >= VERTEX_FORMAT_COUNT) {
+        throw std::invalid_argument("Invalid vertex format");
+    }
+    return VERTEX_LAYOUTS[format];
+}
+
+std::vector<GLubyte> packVertices(const Vertex* vertices, int count, VertexFormat format) {
+    const VertexLayout& layout = vertexLayout(format);
+    std::vector<GLubyte> bytes(static_cast<std::size_t>(count) * layout.stride);
+    GLubyte* out = bytes.data();
+    for (int i = 0; i < count; i++, out += layout.stride) {
+        const glm::vec2 position(vertices[i].XYZW[0], vertices[i].XYZW[1]);
+        if (format == VERTEX_FLOAT4) {
+            std::memcpy(out, vertices[i].XYZW, sizeof(vertices[i].XYZW));
+        }
+        else if (format == VERTEX_FLOAT2) {
+            std::memcpy(out, &position, sizeof(position));
+        }
+        else if (format == VERTEX_HALF2) {
+            // Half floats hold about three decimal digits, well under a pixel
+            // at the sizes the pieces are drawn
+            const glm::uint32 packed = glm::packHalf2x16(position);
+            std::memcpy(out, &packed, sizeof(packed));
+        }
+        else {
+            const glm::vec2 scaled = position / layout.scale;
+            if (std::abs(scaled.x) > 1.0f || std::abs(scaled.y) > 1.0f) {
+                throw std::invalid_argument("Vertex position out of the snorm16 range");
+            }
+            const glm::uint32 packed = glm::packSnorm2x16(scaled);
+            std::memcpy(out, &packed, sizeof(packed));
+        }
+    }
+    return bytes;
+}
+
+void setupVertexAttribute(GLuint attribute, GLuint binding, VertexFormat format) {
+    const VertexLayout& layout = vertexLayout(format);
+    glEnableVertexAttribArray(attribute);
+    glVertexAttribFormat(attribute, layout.size, layout.type, layout.normalized, 0);
+    glVertexAttribBinding(attribute, binding);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "../mgl/mgl.hpp"
+#include <vector>
+
+typedef struct {
+	GLfloat XYZW[4];
+} Vertex;
+
+// Formats the positions of a mesh can be stored in. The shaders read a vec4
+// either way: two-component formats are filled with z = 0 and w = 1, which is
+// all a 2D shape needs, so only FLOAT4 keeps z and w from the vertices.
+enum VertexFormat {
+	VERTEX_FLOAT4,
+	VERTEX_FLOAT2,
+	VERTEX_HALF2,
+	VERTEX_SNORM16X2,
+	VERTEX_FORMAT_COUNT
+};
+
+// Positions stored as snorm16 are divided by this, so that shapes reaching
+// beyond the unit square still fit in [-1, 1]. A power of two, so that the
+// division is exact.
+constexpr float SNORM_POSITION_SCALE = 2.0f;
+
+// Everything glVertexAttribFormat needs, plus the factor the shader has to
+// multiply the position by to undo the packing.
+struct VertexLayout {
+	GLint size;
+	GLenum type;
+	GLboolean normalized;
+	GLuint stride;
+	float scale;
+};
+
+constexpr VertexLayout VERTEX_LAYOUTS[VERTEX_FORMAT_COUNT] = {
+	{4, GL_FLOAT, GL_FALSE, 16, 1.0f},
+	{2, GL_FLOAT, GL_FALSE, 8, 1.0f},
+	{2, GL_HALF_FLOAT, GL_FALSE, 4, 1.0f},
+	{2, GL_SHORT, GL_TRUE, 4, SNORM_POSITION_SCALE}
+};
+
+const VertexLayout& vertexLayout(VertexFormat format);
+
+// Bytes of the vertices in the given format, stride bytes per vertex. Throws
+// if a position does not fit the format.
+std::vector<GLubyte> packVertices(const Vertex* vertices, int count, VertexFormat format);
+
+// Enables the attribute, sets its format and connects it to the binding point
+// of the bound vertex array. The buffer itself is attached with
+// glBindVertexBuffer and the stride of the layout.
+void setupVertexAttribute(GLuint attribute, GLuint binding, VertexFormat format);
@@ -1,15 +1,24 @@
-#version 330 core
+#version 450 core
+#extension GL_ARB_shader_draw_parameters : require
 
 layout(location = 0) in vec4 inPosition;
 
-// in vec4 inPosition;
-// in vec4 inColor;
-out vec4 exColor;
+// Undoes the scaling of positions packed as snorm16
+uniform float PositionScale = 1.0;
+
+// Per-piece data, indexed by PieceId: the base instance of each draw is the
+// first piece of its mesh
+layout(std430) readonly buffer PieceMatrices {
+    mat4 Matrices[];
+};
+layout(std430) readonly buffer PieceColors {
+    vec4 Colors[];
+};
 
-uniform mat4 Matrix;
-uniform vec4 Color;
+out vec4 exColor;
 
 void main(void) {
-    gl_Position = Matrix * inPosition;
-    exColor = Color;
+    const int piece = gl_BaseInstanceARB + gl_InstanceID;
+    gl_Position = Matrices[piece] * vec4(inPosition.xy * PositionScale, inPosition.zw);
+    exColor = Colors[piece];
 }
@@ -0,0 +1,48 @@
+#version 450 core
+
+// Polygons of the shapes, 4 vertices per shape
+layout(std140) uniform SdfShapes {
+    vec4 Vertices[12];
+    vec4 VertexCounts;
+};
+
+uniform float OutlineWidth; // In pixels, 0 for none
+uniform vec4 OutlineColor;
+
+in vec2 exLocal;
+flat in int exShape;
+flat in vec4 exColor;
+out vec4 outColor;
+
+// Signed distance from p to a polygon, negative inside.
+float polygonDistance(const vec2 p, const int shape) {
+    const int first = shape * 4;
+    const int count = int(VertexCounts[shape]);
+    float squared = dot(p - Vertices[first].xy, p - Vertices[first].xy);
+    float inside = 1.0;
+    for (int i = 0, j = count - 1; i < count; j = i, i++) {
+        const vec2 a = Vertices[first + i].xy, b = Vertices[first + j].xy;
+        const vec2 edge = b - a, w = p - a;
+        const vec2 nearest = w - edge * clamp(dot(w, edge) / dot(edge, edge), 0.0, 1.0);
+        squared = min(squared, dot(nearest, nearest));
+        // Crossing number of a ray from p
+        const bvec3 c = bvec3(p.y >= a.y, p.y < b.y, edge.x * w.y > edge.y * w.x);
+        if (all(c) || all(not(c))) {
+            inside = -inside;
+        }
+    }
+    return inside * sqrt(squared);
+}
+
+void main(void) {
+    const float d = polygonDistance(exLocal, exShape);
+    // Size of a pixel in the space of the shape, which is only rotated and scaled
+    const float pixel = length(vec2(dFdx(exLocal.x), dFdy(exLocal.x)));
+    const float coverage = clamp(0.5 - d / pixel, 0.0, 1.0);
+    if (coverage <= 0.0) {
+        discard;
+    }
+    // The outline covers OutlineWidth pixels inside the edge
+    const float outline = OutlineWidth > 0.0 ? clamp(d / pixel + OutlineWidth + 0.5, 0.0, 1.0) : 0.0;
+    outColor = vec4(mix(exColor.rgb, OutlineColor.rgb, outline * OutlineColor.a), exColor.a * coverage);
+}
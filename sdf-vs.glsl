@@ -0,0 +1,34 @@
+#version 450 core
+#extension GL_ARB_shader_draw_parameters : require
+
+// xy: corner of the bounding quad of the shape, z: shape, w: corner
+layout(location = 0) in vec4 inPosition;
+
+// Per-piece data, indexed by PieceId as in clip-vs.glsl
+layout(std430) readonly buffer PieceMatrices {
+    mat4 Matrices[];
+};
+layout(std430) readonly buffer PieceColors {
+    vec4 Colors[];
+};
+
+uniform vec2 Viewport;      // In pixels
+uniform float OutlineWidth; // In pixels
+
+out vec2 exLocal;
+flat out int exShape;
+flat out vec4 exColor;
+
+const vec2 OUTWARDS[4] = vec2[](vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0));
+
+void main(void) {
+    const int piece = gl_BaseInstanceARB + gl_InstanceID;
+    const mat4 matrix = Matrices[piece];
+    // Room for the outline and the antialiased edge, a pixel being measured in
+    // the space of the shape from the scale of the matrix
+    const float pixel = 2.0 / (min(Viewport.x, Viewport.y) * length(matrix[0].xy));
+    exLocal = inPosition.xy + OUTWARDS[int(inPosition.w)] * (OutlineWidth + 1.0) * pixel;
+    exShape = int(inPosition.z);
+    exColor = Colors[piece];
+    gl_Position = matrix * vec4(exLocal, 0.0, 1.0);
+}